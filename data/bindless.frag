@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+
+// The textures of all materials in one array, indexed per instance, so a
+// scene with many textures is drawn without binding descriptor sets in
+// between. Only the slots in use are bound.
+layout(set = 1, binding = 0) uniform texture2D textures[];
+layout(binding = 1) uniform sampler tex_sampler;
+
+layout(location = 0) in vec3 frag_color;
+layout(location = 1) in vec2 frag_tex_coord;
+layout(location = 2) flat in uint frag_material;
+
+layout(location = 0) out vec4 out_color;
+
+void main() {
+    // The index may differ between the invocations of a draw.
+    vec4 texel = texture(sampler2D(textures[nonuniformEXT(frag_material)], tex_sampler), frag_tex_coord);
+    out_color = vec4(frag_color * texel.rgb, 1.0);
+}
@@ -0,0 +1,21 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// Depth pre-pass: positions only and no fragment shader.
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 model;
+    mat4 view;
+    mat4 proj;
+} ubo;
+
+layout(location = 0) in vec3 position;
+layout(location = 3) in mat4 instance_model;
+
+// The color pass tests against this depth with VK_COMPARE_OP_EQUAL, so both
+// passes must compute exactly the same positions.
+invariant gl_Position;
+
+void main () {
+    gl_Position = ubo.proj * ubo.view * instance_model * ubo.model * vec4(position, 1.0);
+}
@@ -10,12 +10,20 @@ layout(binding = 0) uniform UniformBufferObject {
 layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 color;
 layout(location = 2) in vec2 tex_coord;
+layout(location = 3) in mat4 instance_model;
+layout(location = 7) in uint instance_material;
 
 layout(location = 0) out vec3 frag_color;
 layout(location = 1) out vec2 frag_tex_coord;
+// Only read by the bindless fragment shader.
+layout(location = 2) flat out uint frag_material;
+
+// Must match the depth pre-pass (depth.vert) exactly.
+invariant gl_Position;
 
 void main () {
-    gl_Position = ubo.proj * ubo.view * ubo.model * vec4(position, 1.0);
+    gl_Position = ubo.proj * ubo.view * instance_model * ubo.model * vec4(position, 1.0);
     frag_color = color;
     frag_tex_coord = tex_coord;
+    frag_material = instance_material;
 }
@@ -0,0 +1,101 @@
+#include "Ktx2.hpp"
+#include "BlockCompression.hpp"
+#include "MipGeneration.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+// Converts an image to a KTX2 file with its full mip chain, so the loader
+// only has to copy the levels instead of generating them at runtime. The
+// levels are stored uncompressed or encoded into BC1 or BC3 blocks, a
+// quarter or half of the size; auto picks BC1 for opaque images and BC3
+// otherwise.
+//
+// Usage: ktx2_convert [--format rgba8|bc1|bc3|auto] <input image> <output.ktx2>
+
+namespace vktest {
+    static bool is_opaque (const std::vector<unsigned char> &texels) noexcept {
+        for (size_t i = 3; i < texels.size(); i += 4) {
+            if (texels[i] != 255) return false;
+        }
+        return true;
+    }
+
+    static VkFormat select_format (const std::string &name, const std::vector<unsigned char> &texels) {
+        if (name == "rgba8") return VK_FORMAT_R8G8B8A8_SRGB;
+        if (name == "bc1") return VK_FORMAT_BC1_RGB_SRGB_BLOCK;
+        if (name == "bc3") return VK_FORMAT_BC3_SRGB_BLOCK;
+        if (name == "auto") return is_opaque(texels) ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC3_SRGB_BLOCK;
+        throw std::runtime_error("Unknown format " + name);
+    }
+
+    static void convert (const std::string &format_name, const char *input, const char *output) {
+        int width, height, channels;
+        stbi_uc *pixels = stbi_load(input, &width, &height, &channels, STBI_rgb_alpha);
+        if (!pixels) throw std::runtime_error(std::string("Failed to load image ") + input);
+        std::vector<std::vector<unsigned char>> levels;
+        levels.emplace_back(pixels, pixels + static_cast<size_t>(width) * height * 4);
+        stbi_image_free(pixels);
+
+        VkFormat format = select_format(format_name, levels[0]);
+
+        // The same box filter as the loader uses for textures without mip
+        // levels, in linear space.
+        uint32_t level_count = get_mip_level_count(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
+        for (uint32_t i = 1; i < level_count; i++) {
+            levels.emplace_back(get_level_size(VK_FORMAT_R8G8B8A8_SRGB,
+                                               std::max(static_cast<uint32_t>(width) >> i, 1u),
+                                               std::max(static_cast<uint32_t>(height) >> i, 1u)));
+        }
+        std::vector<unsigned char*> level_data {};
+        for (size_t i = 1; i < levels.size(); i++) level_data.push_back(levels[i].data());
+        generate_mip_levels(VK_FORMAT_R8G8B8A8_SRGB, levels[0].data(),
+                            static_cast<uint32_t>(width), static_cast<uint32_t>(height), level_data);
+
+        // Every level is encoded from the downsampled texels, not from the
+        // blocks of the level above.
+        if (is_block_compressed(format)) {
+            for (size_t i = 0; i < levels.size(); i++) {
+                levels[i] = encode_blocks(format, levels[i].data(),
+                                          std::max(static_cast<uint32_t>(width) >> i, 1u),
+                                          std::max(static_cast<uint32_t>(height) >> i, 1u));
+            }
+        }
+
+        std::vector<unsigned char> file = write_ktx2(format,
+                                                     static_cast<uint32_t>(width),
+                                                     static_cast<uint32_t>(height),
+                                                     levels);
+        std::ofstream out { output, std::ios::binary };
+        if (!out.is_open()) throw std::runtime_error(std::string("Failed to open file ") + output);
+        out.write(reinterpret_cast<const char*>(file.data()), static_cast<std::streamsize>(file.size()));
+        if (!out) throw std::runtime_error(std::string("Failed to write file ") + output);
+    }
+}
+
+int main (int argc, char *argv[]) {
+    std::string format = "rgba8";
+    int first = 1;
+    if (argc == 5 && std::string(argv[1]) == "--format") {
+        format = argv[2];
+        first = 3;
+    }
+    if (argc - first != 2) {
+        std::cerr << "Usage: " << argv[0] << " [--format rgba8|bc1|bc3|auto] <input image> <output.ktx2>" << std::endl;
+        return 1;
+    }
+    try {
+        vktest::convert(format, argv[first], argv[first + 1]);
+    } catch (const std::exception &e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
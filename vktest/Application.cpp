@@ -1,6 +1,8 @@
 #include "Application.hpp"
 #include "config.hpp"
-#include "UniformBufferObject.hpp"
+#include "MeshSimplifier.hpp"
+#include "BlockCompression.hpp"
+#include "MipGeneration.hpp"
 #include <stdexcept>
 #include <cstring>
 #include <tuple>
@@ -8,31 +10,163 @@
 #include <iostream>
 #include <unordered_map>
 #include <cmath>
+#include <limits>
+
+namespace vktest {
+    // Stands in for the texture until it is loaded: a single white texel.
+    static TextureData make_placeholder_texture (const Device &device) {
+        TextureData texture {};
+        texture.width = 1;
+        texture.height = 1;
+        texture.levels.push_back({ 0, 4 });
+        texture.staging = std::make_unique<StagingBuffer>(device, 4);
+        std::memset(texture.staging->get_data(), 255, 4);
+        return texture;
+    }
+
+    // Stands in for the model until it is loaded: a single degenerate
+    // triangle, which draws nothing but gives every buffer a valid size.
+    static ModelData make_placeholder_model () {
+        ModelData model {};
+        Vertex vertex {};
+        vertex.color = {1.0f, 1.0f, 1.0f};
+        model.vertices.push_back(vertex);
+        model.indices = { 0, 0, 0 };
+        return model;
+    }
 
-#define STB_IMAGE_IMPLEMENTATION
-#include <stb_image.h>
+    // The same levels as 8-bit RGBA texels, decoded from one staging buffer
+    // straight into another. The loader places the blocks in cached memory
+    // where it can, since they are read back here.
+    static TextureData decompress_texture (const Device &device, const TextureData &texture) {
+        TextureData decompressed {};
+        decompressed.format = get_decompressed_format(texture.format);
+        decompressed.width = texture.width;
+        decompressed.height = texture.height;
+        size_t size = 0;
+        for (size_t i = 0; i < texture.levels.size(); i++) {
+            size_t level_size = get_level_size(decompressed.format,
+                                               std::max(texture.width >> i, 1u),
+                                               std::max(texture.height >> i, 1u));
+            decompressed.levels.push_back({ size, level_size });
+            size += level_size;
+        }
+        // Read back if the mip levels are generated on the CPU.
+        decompressed.staging = std::make_unique<StagingBuffer>(device, size, texture.levels.size() == 1);
+        for (size_t i = 0; i < texture.levels.size(); i++) {
+            decode_blocks(texture.format,
+                          texture.staging->get_data() + texture.levels[i].offset,
+                          std::max(texture.width >> i, 1u),
+                          std::max(texture.height >> i, 1u),
+                          decompressed.staging->get_data() + decompressed.levels[i].offset);
+        }
+        return decompressed;
+    }
 
-#define TINYOBJLOADER_IMPLEMENTATION
-#include <tiny_obj_loader.h>
+    // Every shader the application may use, read while the device is being
+    // created.
+    static const char *const SHADER_PATHS[] {
+        "data/shader.vert.spv",
+        "data/depth.vert.spv",
+        "data/shader.frag.spv",
+        "data/bindless.frag.spv",
+        "data/cull.comp.spv",
+        "data/depth_resolve.comp.spv",
+        "data/depth_reduce.comp.spv",
+        "data/mip_generate.comp.spv"
+    };
+
+    // The levels data/mip_generate.comp binds at once, enough for textures
+    // of up to 32768x32768.
+    static const uint32_t MIP_GENERATION_MAX_LEVELS = 16;
+
+    static const char *get_mip_generator_name (MipGenerator generator) noexcept {
+        switch (generator) {
+            case MipGenerator::blit: return "blit";
+            case MipGenerator::compute: return "compute";
+            case MipGenerator::cpu: return "CPU";
+        }
+        return "unknown";
+    }
+}
 
 vktest::Application::Application (std::string app_name)
         : _app_name { std::move(app_name) },
+          _quality_profile {DEFAULT_QUALITY_PROFILE},
+          _requested_quality_profile {},
+          _dynamic_rendering {false},
+          _render_graph {},
+          _scene_image {nullptr},
+          _scene_blit_filter {VK_FILTER_LINEAR},
+          _render_extent {},
+          _depth_history_extent {},
+          _resolution_controller {TARGET_FRAME_TIME, MIN_RENDER_SCALE, MAX_RENDER_SCALE},
+          _timestamps_written {},
+          _last_frame_start {},
+          _color_image {nullptr},
+          _depth_image {nullptr},
+          _depth_pyramid_levels {0},
+          _depth_pyramid_level_views {},
+          _depth_history {false},
+          _texture_format {VK_FORMAT_R8G8B8A8_SRGB},
+          _bindless {false},
+          _bindless_texture_count {0},
+          _texture_pending {false},
+          _texture_index {0},
+          _model_pending {false},
+          _draws {},
+          _gpu_culling {false},
           _uniform_buffer_memories {},
           _uniform_buffers {},
-          _descriptor_sets {},
+          _visible_index_buffer_memories {},
+          _visible_index_buffers {},
+          _instance_buffer_memories {},
+          _instance_buffers {},
+          _cull_uniform_buffer_memories {},
+          _cull_uniform_buffers {},
+          _draw_command_buffer_memories {},
+          _draw_command_buffers {},
+          _draw_count_buffer_memories {},
+          _draw_count_buffers {},
+          _push_descriptors {false},
+          _scene_descriptor_set {VK_NULL_HANDLE},
+          _descriptor_allocators {},
+          _cull_descriptor_sets {},
+          _depth_pyramid_descriptor_sets {},
           _image_available_semaphores {},
           _render_finished_semaphores {},
           _in_flight_fences {},
           _images_in_flight {},
           _current_frame {0},
-          _framebuffer_resized {false} {
+          _frame_number {0},
+          _in_flight_frame_numbers {},
+          _framebuffer_resized {false},
+          _deletion_queue {} {
     init();
     loop();
 }
 
 void vktest::Application::init () {
+    // The assets load on worker threads while the window, the device and the
+    // pipelines are created, and are waited for where they are uploaded. The
+    // texture is decoded into a staging buffer, so it is requested as soon
+    // as the device exists.
+    start_asset_loading();
     init_window();
     init_vulkan();
+    // Unless the model or the texture are still loading in the background.
+    if (!_model_pending && !_texture_pending) _asset_loader.reset();
+}
+
+void vktest::Application::start_asset_loading () {
+    _asset_loader = std::make_unique<AssetLoader>();
+    _asset_loader->request_model(MODEL_PATH);
+    for (const char *path : SHADER_PATHS) _asset_loader->request_file(path);
+}
+
+std::unique_ptr<vktest::Shader> vktest::Application::create_shader (const std::string &path,
+                                                                     VkShaderStageFlagBits stage) {
+    return std::make_unique<Shader>(*_device, _asset_loader->take_file(path), (ShaderDesc) { stage, "main" });
 }
 
 void vktest::Application::loop () {
@@ -41,31 +175,134 @@ void vktest::Application::loop () {
         update();
     }
     _device->wait_idle();
+    _deletion_queue.clear();
+    if (REPORT_OBJECT_CACHE) report_object_cache();
 }
 
 void vktest::Application::update () {
+    if (_requested_quality_profile) {
+        apply_quality_profile(*_requested_quality_profile);
+        _requested_quality_profile.reset();
+    }
+    if (_asset_loader) swap_in_loaded_assets();
     draw();
 }
 
+// Between frames, so a frame uses either the placeholders or the loaded
+// assets, never a mix of the buffers of both. The frames in flight keep the
+// placeholders until they complete.
+void vktest::Application::swap_in_loaded_assets () {
+    if (_texture_pending && _asset_loader->is_ready(TEXTURE_PATH)) {
+        TextureData texture = _asset_loader->take_texture(TEXTURE_PATH, *_device);
+        _deletion_queue.retire(_frame_number, std::move(_texture_image_view));
+        _deletion_queue.retire(_frame_number, std::move(_texture_image));
+        _deletion_queue.retire(_frame_number, std::move(_texture_image_memory));
+        create_texture_image(texture);
+        create_texture_image_view();
+        // The sampler covers the mip levels of the texture.
+        create_texture_sampler();
+        if (_bindless) {
+            // The slot of the placeholder may be in use by the frames in
+            // flight, so the texture takes a new one and the instances are
+            // pointed at it.
+            _texture_index = add_bindless_texture(*_texture_image_view);
+            for (InstanceData &instance : _instances) instance.material = _texture_index;
+            recreate_scene_buffers();
+        }
+        _texture_pending = false;
+    }
+    if (_model_pending && _asset_loader->is_ready(MODEL_PATH)) {
+        load_model(_asset_loader->take_model(MODEL_PATH));
+        _deletion_queue.retire(_frame_number, std::move(_position_buffer));
+        _deletion_queue.retire(_frame_number, std::move(_position_buffer_memory));
+        _deletion_queue.retire(_frame_number, std::move(_attribute_buffer));
+        _deletion_queue.retire(_frame_number, std::move(_attribute_buffer_memory));
+        _deletion_queue.retire(_frame_number, std::move(_index_buffer));
+        _deletion_queue.retire(_frame_number, std::move(_index_buffer_memory));
+        _deletion_queue.retire(_frame_number, std::move(_visible_index_buffers));
+        _deletion_queue.retire(_frame_number, std::move(_visible_index_buffer_memories));
+        _visible_index_buffers.clear();
+        _visible_index_buffer_memories.clear();
+        create_vertex_buffer();
+        create_index_buffer();
+        create_visible_index_buffers();
+        recreate_scene_buffers();
+        _model_pending = false;
+    }
+    if (!_model_pending && !_texture_pending) _asset_loader.reset();
+}
+
+// The object and LOD buffers, and the culling sets that refer to them.
+void vktest::Application::recreate_scene_buffers () {
+    if (!_gpu_culling) return;
+    _deletion_queue.retire(_frame_number, std::move(_cull_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_descriptor_pool));
+    _deletion_queue.retire(_frame_number, std::move(_object_buffer));
+    _deletion_queue.retire(_frame_number, std::move(_object_buffer_memory));
+    _deletion_queue.retire(_frame_number, std::move(_lod_buffer));
+    _deletion_queue.retire(_frame_number, std::move(_lod_buffer_memory));
+    create_scene_buffers();
+    create_descriptor_pool();
+    create_cull_descriptor_sets();
+    create_depth_pyramid_descriptor_sets();
+}
+
 void vktest::Application::init_window () {
     _init = std::make_unique<Initalization>();
     _window = std::make_unique<Window>(WIDTH, HEIGHT, _app_name);
-    _window->set_user_pointer(&_framebuffer_resized);
+    _window->set_user_pointer(this);
     _window->set_framebuffer_resize_callback(on_framebuffer_resize);
+    _window->set_key_callback(on_key);
 }
 
 void vktest::Application::on_framebuffer_resize (GLFWwindow *window, int width, int height) {
-    bool *resized = static_cast<bool*>(glfwGetWindowUserPointer(window));
-    *resized = true;
+    Application *app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    app->_framebuffer_resized = true;
+}
+
+void vktest::Application::on_key (GLFWwindow *window, int key, int scancode, int action, int mods) {
+    if (action != GLFW_PRESS) return;
+    Application *app = static_cast<Application*>(glfwGetWindowUserPointer(window));
+    // 1, 2, ... select the quality profiles in order.
+    if (key >= GLFW_KEY_1 && key < GLFW_KEY_1 + static_cast<int>(quality_profiles.size())) {
+        app->_requested_quality_profile = static_cast<size_t>(key - GLFW_KEY_1);
+    }
+}
+
+// Rebuilds what depends on the sample count, sample shading and anisotropy:
+// the render pass, the attachments, the pipelines and the texture sampler.
+// The swap chain and the buffers are kept.
+void vktest::Application::apply_quality_profile (size_t index) {
+    if (index == _quality_profile) return;
+    _quality_profile = index;
+    _msaa_samples = get_usable_sample_count(quality_profiles[index].max_samples);
+
+    // The frames in flight keep using the old objects, which are destroyed
+    // once they have completed.
+    _deletion_queue.retire(_frame_number, std::move(_cull_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_descriptor_pool));
+
+    recreate_pipelines();
+    create_render_graph();
+    create_framebuffers();
+    create_texture_sampler();
+    create_descriptor_pool();
+    create_cull_descriptor_sets();
+    create_depth_pyramid_descriptor_sets();
+    _window->set_title(_app_name + " - " + quality_profiles[index].name);
 }
 
 void vktest::Application::init_vulkan () {
-    _instance = std::make_unique<Instance>( _app_name.c_str() );
+    // Vulkan 1.2 for drawIndirectCount and 1.3 for dynamic rendering; older
+    // devices fall back to the paths that do not need them.
+    _instance = std::make_unique<Instance>( _app_name.c_str(), VK_API_VERSION_1_3 );
     _surface = std::make_unique<Surface>(*_instance, *_window);
 
     _instance->select_physical_device(*_surface);
     _physical_device = &(_instance->get_physical_device());
-    _msaa_samples = get_max_usable_sample_count();
+    _msaa_samples = get_usable_sample_count(quality_profiles[_quality_profile].max_samples);
     uint32_t graphics_queue_family = _physical_device->get_queue_families().graphics.value();
     uint32_t present_queue_family = _physical_device->get_queue_families().present.value();
     // uint32_t transfer_queue_family = _physical_device->get_queue_families().transfer.value();
@@ -74,48 +311,82 @@ void vktest::Application::init_vulkan () {
         {graphics_queue_family, 1, 1.0f}, {present_queue_family, 1, 1.0f} // , {transfer_queue_family, 1, 1.0f}
     };
     _device = std::make_unique<Device>(*_physical_device, queue_create_descs);
+    _asset_loader->request_texture(TEXTURE_PATH, *_device);
+    _object_cache = std::make_unique<ObjectCache>(*_device);
     _graphics_queue = &(_device->get_queue(graphics_queue_family, 0));
     _present_queue = &(_device->get_queue(present_queue_family, 0));
+    _dynamic_rendering = DYNAMIC_RENDERING && _device->get_features().dynamic_rendering;
+    _bindless = BINDLESS && _device->get_features().descriptor_indexing;
+    _push_descriptors = PUSH_DESCRIPTORS && _device->get_features().push_descriptor;
 
-    _command_pool = std::make_unique<CommandPool>(*_device, graphics_queue_family, 0);
+    // Command buffers are re-recorded every frame, so they have to be
+    // individually resettable.
+    _command_pool = std::make_unique<CommandPool>(*_device, graphics_queue_family, VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT);
     create_swap_chain();
-
-    _vert_shader = std::make_unique<Shader>(*_device, "data/shader.vert.spv", (ShaderDesc) { VK_SHADER_STAGE_VERTEX_BIT, "main" });
-    _frag_shader = std::make_unique<Shader>(*_device, "data/shader.frag.spv", (ShaderDesc) { VK_SHADER_STAGE_FRAGMENT_BIT, "main" });
+    // The scene decides between the CPU and the GPU-driven paths, which need
+    // different attachments. The placeholder has as many instances as the
+    // model, so the decision holds once the model is swapped in.
+    _model_pending = PROGRESSIVE_STARTUP;
+    load_model(_model_pending ? make_placeholder_model() : _asset_loader->take_model(MODEL_PATH));
+    _gpu_culling = can_cull_on_gpu();
+
+    _vert_shader = create_shader("data/shader.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    _depth_vert_shader = create_shader("data/depth.vert.spv", VK_SHADER_STAGE_VERTEX_BIT);
+    const char *frag_shader_path = _bindless ? "data/bindless.frag.spv" : "data/shader.frag.spv";
+    _frag_shader = create_shader(frag_shader_path, VK_SHADER_STAGE_FRAGMENT_BIT);
+    _cull_shader = create_shader("data/cull.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+    _depth_resolve_shader = create_shader("data/depth_resolve.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+    _depth_reduce_shader = create_shader("data/depth_reduce.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
+    _mip_generation_shader = create_shader("data/mip_generate.comp.spv", VK_SHADER_STAGE_COMPUTE_BIT);
 
     create_render_pass();
     create_descriptor_set_layout();
     create_pipeline();
+    create_mip_generation_pipeline();
 
-    create_color_resources();
-    create_depth_resources();
+    create_render_graph();
     create_framebuffers();
-    create_texture_image();
+    _texture_pending = PROGRESSIVE_STARTUP;
+    create_texture_image(_texture_pending ? make_placeholder_texture(*_device)
+                                          : _asset_loader->take_texture(TEXTURE_PATH, *_device));
     create_texture_image_view();
     create_texture_sampler();
-    load_model();
+    create_bindless_descriptor_set();
     create_vertex_buffer();
     create_index_buffer();
+    create_scene_buffers();
     create_uniform_buffers();
+    create_visible_index_buffers();
+    create_instance_buffers();
+    create_cull_buffers();
     create_descriptor_pool();
-    create_descriptor_sets();
+    create_descriptor_allocators();
+    create_cull_pipeline();
+    create_cull_descriptor_sets();
+    create_depth_pyramid_descriptor_sets();
     create_command_buffers();
-    record_command_buffers();
+    create_query_pool();
     create_sync_objects();
 }
 
 void vktest::Application::create_swap_chain () {
     SwapChainSupport swap_chain_support = _physical_device->query_swap_chain_support(*_surface);
-    _swap_chain = std::make_unique<SwapChain>(*_device, *_surface, swap_chain_support);
+    // The previous swap chain is replaced in place, and destroyed once the
+    // frames that render to its images have completed.
+    std::unique_ptr<SwapChain> old_swap_chain = std::move(_swap_chain);
+    _swap_chain = std::make_unique<SwapChain>(*_device, *_surface, swap_chain_support, old_swap_chain.get());
+    if (old_swap_chain) _deletion_queue.retire(_frame_number, std::move(old_swap_chain));
 }
 
 void vktest::Application::create_render_pass () {
+    if (_dynamic_rendering) return;
     std::vector<VkSubpassDependency> dependencies = prepare_subpass_dependencies();
-    _render_pass = std::make_unique<RenderPass>(*_device,
-                                                _swap_chain->get_image_format(),
-                                                find_depth_format(),
-                                                _msaa_samples,
-                                                dependencies);
+    _render_pass = _object_cache->get_render_pass(_swap_chain->get_image_format(),
+                                                  find_depth_format(),
+                                                  _msaa_samples,
+                                                  dependencies,
+                                                  DEPTH_PREPASS,
+                                                  _gpu_culling);
 }
 
 std::vector<VkSubpassDependency> vktest::Application::prepare_subpass_dependencies () const noexcept {
@@ -129,8 +400,9 @@ std::vector<VkSubpassDependency> vktest::Application::prepare_subpass_dependenci
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
     // The two fields specify the operations to wait on and the stages in which
-    // these operations occur. We need to wait for the swap chain to finish
-    // reading from the image before we can access it.
+    // these operations occur. The render graph already waited for the earlier
+    // accesses to the attachments with barriers into these stages, so the
+    // dependency only has to chain to them.
     dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.srcAccessMask = 0;
     // The operations that should wait on this are in the color attachment
@@ -139,7 +411,38 @@ std::vector<VkSubpassDependency> vktest::Application::prepare_subpass_dependenci
     // (and allowed): when we want to start writing colors to it.
     dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
     dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-    std::vector<VkSubpassDependency> dependencies {dependency};
+    // The blit after the render pass reads the scene image.
+    VkSubpassDependency blit_dependency {};
+    blit_dependency.srcSubpass = 0;
+    blit_dependency.dstSubpass = VK_SUBPASS_EXTERNAL;
+    blit_dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+    blit_dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    blit_dependency.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    blit_dependency.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    std::vector<VkSubpassDependency> dependencies {dependency, blit_dependency};
+    if (!DEPTH_PREPASS) return dependencies;
+
+    // With a depth pre-pass, the color attachments are first used by subpass
+    // 1, which also has to wait for the depth written by subpass 0.
+    dependencies[0].dstSubpass = 1;
+    dependencies[1].srcSubpass = 1;
+    VkSubpassDependency depth_dependency {};
+    depth_dependency.srcSubpass = 0;
+    depth_dependency.dstSubpass = 1;
+    depth_dependency.srcStageMask = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depth_dependency.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+    // Only the same pixel is read back.
+    depth_dependency.dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT;
+    dependencies.push_back(depth_dependency);
+
+    VkSubpassDependency external_depth_dependency = dependency;
+    external_depth_dependency.dstSubpass = 0;
+    external_depth_dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    external_depth_dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    external_depth_dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependencies.push_back(external_depth_dependency);
     return dependencies;
 }
 
@@ -153,7 +456,9 @@ void vktest::Application::create_descriptor_set_layout () {
 
     VkDescriptorSetLayoutBinding sampler_layout_binding {};
     sampler_layout_binding.binding = 1;
-    sampler_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    // The bindless textures are sampled with this sampler, see
+    // *_bindless_descriptor_set_layout*.
+    sampler_layout_binding.descriptorType = _bindless ? VK_DESCRIPTOR_TYPE_SAMPLER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
     sampler_layout_binding.descriptorCount = 1;
     // We intend to use the combined image sampler descriptor in the fragment
     // shader. That's where the color of the fragment is going to be determined.
@@ -163,64 +468,381 @@ void vktest::Application::create_descriptor_set_layout () {
     sampler_layout_binding.pImmutableSamplers = nullptr; // Optional
 
     std::vector<VkDescriptorSetLayoutBinding> bindings { ubo_layout_binding, sampler_layout_binding };
-    _descriptor_set_layout = std::make_unique<DescriptorSetLayout>(*_device, bindings);
+    // A push descriptor layout is never allocated from a pool.
+    VkDescriptorSetLayoutCreateFlags flags = _push_descriptors ? VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR : 0;
+    _descriptor_set_layout = _object_cache->get_descriptor_set_layout(bindings, flags);
+    if (!_bindless) return;
+
+    // One large array of sampled images. Only the slots that hold a texture
+    // are written (partially bound), and new textures are written while the
+    // set is bound by frames in flight (update after bind), as long as those
+    // do not use the slot.
+    VkDescriptorSetLayoutBinding textures_binding {};
+    textures_binding.binding = 0;
+    textures_binding.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    textures_binding.descriptorCount = BINDLESS_TEXTURE_COUNT;
+    textures_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    std::vector<VkDescriptorBindingFlags> binding_flags {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT
+      | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT
+      | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT
+    };
+    _bindless_descriptor_set_layout = _object_cache->get_descriptor_set_layout(
+            std::vector<VkDescriptorSetLayoutBinding> { textures_binding },
+            VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT,
+            binding_flags);
 }
 
 void vktest::Application::create_pipeline () {
     std::vector<DescriptorSetLayout*> desc_set_layouts { _descriptor_set_layout.get() };
-    _pipeline_layout = std::make_unique<PipelineLayout>(*_device, desc_set_layouts);
+    if (_bindless) desc_set_layouts.push_back(_bindless_descriptor_set_layout.get());
+    _pipeline_layout = _object_cache->get_pipeline_layout(desc_set_layouts);
+
+    std::vector<VkPipelineShaderStageCreateInfo> stages { _vert_shader->get_stage_info(), _frag_shader->get_stage_info() };
+    std::vector<VkVertexInputBindingDescription> binding_descs = Vertex::get_binding_descs();
+    std::vector<VkVertexInputAttributeDescription> attrib_descs = Vertex::get_attribute_descs();
+    std::vector<VkVertexInputBindingDescription> instance_binding_descs = InstanceData::get_binding_descs();
+    std::vector<VkVertexInputAttributeDescription> instance_attrib_descs = InstanceData::get_attribute_descs();
+    binding_descs.insert(binding_descs.end(), instance_binding_descs.begin(), instance_binding_descs.end());
+    attrib_descs.insert(attrib_descs.end(), instance_attrib_descs.begin(), instance_attrib_descs.end());
+    // The render extent changes from frame to frame, see *update_render_extent*.
+    PipelineOptions color_options {};
+    color_options.sample_shading = quality_profiles[_quality_profile].sample_shading;
+    color_options.dynamic_viewport = true;
+    if (!DEPTH_PREPASS) {
+        _pipeline = create_graphics_pipeline(stages, binding_descs, attrib_descs, color_options);
+        return;
+    }
+
+    // The color subpass only shades the fragments whose depth the pre-pass
+    // left in the depth attachment. With dynamic rendering, both passes draw
+    // in the same rendering scope instead.
+    color_options.subpass = _dynamic_rendering ? 0 : 1;
+    color_options.depth_compare_op = VK_COMPARE_OP_EQUAL;
+    color_options.depth_write = false;
+    _pipeline = create_graphics_pipeline(stages, binding_descs, attrib_descs, color_options);
+
+    // The pre-pass reads only the position stream and the instance
+    // transforms, and has no fragment shader.
+    std::vector<VkPipelineShaderStageCreateInfo> depth_stages { _depth_vert_shader->get_stage_info() };
+    std::vector<VkVertexInputBindingDescription> depth_binding_descs = Vertex::get_position_binding_descs();
+    std::vector<VkVertexInputAttributeDescription> depth_attrib_descs = Vertex::get_position_attribute_descs();
+    depth_binding_descs.insert(depth_binding_descs.end(), instance_binding_descs.begin(), instance_binding_descs.end());
+    depth_attrib_descs.insert(depth_attrib_descs.end(), instance_attrib_descs.begin(), instance_attrib_descs.end());
+    PipelineOptions depth_options {};
+    depth_options.color_output = false;
+    depth_options.sample_shading = false;
+    depth_options.dynamic_viewport = true;
+    _depth_pipeline = create_graphics_pipeline(depth_stages, depth_binding_descs, depth_attrib_descs, depth_options);
+}
 
+std::unique_ptr<vktest::Pipeline> vktest::Application::create_graphics_pipeline (
+        const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+        const std::vector<VkVertexInputBindingDescription> &binding_descs,
+        const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+        const PipelineOptions &options) const {
+    // Only used without dynamic viewport state.
     VkViewport viewport { 0.0f, 0.0f, (float) _swap_chain->get_extent().width, (float) _swap_chain->get_extent().height, 0.0f, 1.0f };
     VkRect2D scissor { {0, 0}, _swap_chain->get_extent() };
-    std::vector<VkPipelineShaderStageCreateInfo> stages { _vert_shader->get_stage_info(), _frag_shader->get_stage_info() };
-    _pipeline = std::make_unique<Pipeline>(*_pipeline_layout, viewport, scissor, stages, *_render_pass, _msaa_samples);
+    if (!_dynamic_rendering) {
+        return std::make_unique<Pipeline>(*_pipeline_layout, viewport, scissor, stages,
+                                          binding_descs, attrib_descs,
+                                          *_render_pass, _msaa_samples, options);
+    }
+    // The color attachment is also declared by the depth-only pipeline,
+    // which draws in the same rendering scope.
+    RenderingFormats formats {};
+    formats.color_format = _swap_chain->get_image_format();
+    formats.depth_format = find_depth_format();
+    return std::make_unique<Pipeline>(*_pipeline_layout, viewport, scissor, stages,
+                                      binding_descs, attrib_descs,
+                                      formats, _msaa_samples, options);
+}
+
+// Rebuilds the render pass and the graphics pipelines, for a new sample
+// count or swap chain format.
+void vktest::Application::recreate_pipelines () {
+    _deletion_queue.retire(_frame_number, std::move(_pipeline));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pipeline));
+    _deletion_queue.retire(_frame_number, std::move(_pipeline_layout));
+    _deletion_queue.retire(_frame_number, std::move(_render_pass));
+    create_render_pass();
+    create_pipeline();
+}
+
+void vktest::Application::create_cull_pipeline () {
+    if (!_gpu_culling || _cull_pipeline) return;
+
+    // Binding 0 holds the per-frame parameters, 1 and 2 the scene, 3 and 4
+    // receive the draw commands and their count.
+    std::vector<VkDescriptorSetLayoutBinding> bindings (6);
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = i == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        bindings[i].pImmutableSamplers = nullptr; // Optional
+    }
+    // Binding 5 is the depth pyramid.
+    bindings[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    _cull_descriptor_set_layout = _object_cache->get_descriptor_set_layout(bindings);
+
+    std::vector<DescriptorSetLayout*> desc_set_layouts { _cull_descriptor_set_layout.get() };
+    _cull_pipeline_layout = _object_cache->get_pipeline_layout(desc_set_layouts);
+    _cull_pipeline = std::make_unique<ComputePipeline>(*_cull_pipeline_layout, _cull_shader->get_stage_info());
+
+    // The depth pyramid is built level by level, each reading the level
+    // below (or the depth attachment) and writing one storage image.
+    std::vector<VkDescriptorSetLayoutBinding> pyramid_bindings (2);
+    pyramid_bindings[0].binding = 0;
+    pyramid_bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramid_bindings[0].descriptorCount = 1;
+    pyramid_bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pyramid_bindings[1].binding = 1;
+    pyramid_bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pyramid_bindings[1].descriptorCount = 1;
+    pyramid_bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    _depth_pyramid_descriptor_set_layout = _object_cache->get_descriptor_set_layout(pyramid_bindings);
+
+    std::vector<DescriptorSetLayout*> pyramid_set_layouts { _depth_pyramid_descriptor_set_layout.get() };
+    _depth_pyramid_pipeline_layout = _object_cache->get_pipeline_layout(pyramid_set_layouts);
+    _depth_resolve_pipeline = std::make_unique<ComputePipeline>(*_depth_pyramid_pipeline_layout, _depth_resolve_shader->get_stage_info());
+    _depth_reduce_pipeline = std::make_unique<ComputePipeline>(*_depth_pyramid_pipeline_layout, _depth_reduce_shader->get_stage_info());
+}
+
+void vktest::Application::create_mip_generation_pipeline () {
+    // The shader indexes an array of storage images, one per level, with the
+    // level it is working on, and writes them as RGBA8 UNORM.
+    VkPhysicalDeviceLimits limits = _physical_device->get_properties().limits;
+    VkFormatProperties format_props = _physical_device->get_format_properties(VK_FORMAT_R8G8B8A8_UNORM);
+    if (!_device->get_features().storage_image_array_dynamic_indexing
+            || limits.maxPerStageDescriptorStorageImages < MIP_GENERATION_MAX_LEVELS
+            || limits.maxDescriptorSetStorageImages < MIP_GENERATION_MAX_LEVELS
+            || !(format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+        return;
+    }
+
+    // Binding 0 holds the levels, 1 the level count, whether the texels are
+    // sRGB and the count of finished work groups.
+    std::vector<VkDescriptorSetLayoutBinding> bindings (2);
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[0].descriptorCount = MIP_GENERATION_MAX_LEVELS;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    _mip_generation_descriptor_set_layout = _object_cache->get_descriptor_set_layout(bindings);
+
+    std::vector<DescriptorSetLayout*> set_layouts { _mip_generation_descriptor_set_layout.get() };
+    _mip_generation_pipeline_layout = _object_cache->get_pipeline_layout(set_layouts);
+    _mip_generation_pipeline = std::make_unique<ComputePipeline>(*_mip_generation_pipeline_layout,
+                                                                 _mip_generation_shader->get_stage_info());
 }
 
 void vktest::Application::create_framebuffers () {
-    _swap_chain->create_framebuffers(*_render_pass, _color_image_view.get(), _depth_image_view.get());
+    _deletion_queue.retire(_frame_number, std::move(_framebuffer));
+    if (_dynamic_rendering) return;
+    // Without a separate (multisampled) color image, the scene image takes
+    // its place in front of the depth attachment.
+    std::vector<const ImageView*> attachments {};
+    attachments.push_back(_color_image_view ? _color_image_view.get() : _scene_image_view.get());
+    attachments.push_back(_depth_image_view.get());
+    if (_color_image_view) attachments.push_back(_scene_image_view.get());
+    _framebuffer = std::make_unique<Framebuffer>(*_device, *_render_pass, _swap_chain->get_extent(), attachments);
 }
 
-void vktest::Application::create_color_resources () {
+void vktest::Application::create_render_graph () {
     VkFormat color_format = _swap_chain->get_image_format();
-    const VkExtent2D &extent = _swap_chain->get_extent();
+    VkFormat depth_format = find_depth_format();
+    // Scaling up filters linearly where the format allows it.
+    VkFormatProperties format_props = _physical_device->get_format_properties(color_format);
+    if ( !(format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_SRC_BIT) ) {
+        throw std::runtime_error("Swap chain image format does not support blitting");
+    }
+    bool linear = format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    _scene_blit_filter = linear ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+    _depth_history = false;
+    // The views go before the images of the previous graph.
+    _deletion_queue.retire(_frame_number, std::move(_scene_image_view));
+    _deletion_queue.retire(_frame_number, std::move(_color_image_view));
+    _deletion_queue.retire(_frame_number, std::move(_depth_image_view));
+    _deletion_queue.retire(_frame_number, std::move(_render_graph));
+    create_depth_pyramid();
+
+    auto graph = std::make_unique<RenderGraph>(*_device);
+    // Only needed within a frame. Without multisampling the scene image is
+    // rendered to directly.
+    RenderGraphImage scene = graph->create_image(prepare_attachment_info(color_format, VK_SAMPLE_COUNT_1_BIT,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT));
+    std::optional<RenderGraphImage> color {};
+    if (_msaa_samples != VK_SAMPLE_COUNT_1_BIT) {
+        color = graph->create_image(prepare_attachment_info(color_format, _msaa_samples,
+                VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT));
+    }
+    // The GPU-driven path reads the depth of the previous frame to build the
+    // depth pyramid, so it is kept across frames. Otherwise, like the
+    // multisampled color, it never leaves the render pass.
+    VkImageUsageFlags depth_usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    depth_usage |= _gpu_culling ? VK_IMAGE_USAGE_SAMPLED_BIT : VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+    RenderGraphImage depth = graph->create_image(prepare_attachment_info(depth_format, _msaa_samples, depth_usage),
+                                                 !_gpu_culling);
+
+    if (_gpu_culling) {
+        RenderGraphImage pyramid = graph->import_image(*_depth_pyramid);
+        // The levels read each other within the pass, which transitions them
+        // itself.
+        graph->add_pass("depth pyramid", [this](const CommandBuffer &cmdbuf, uint32_t) {
+                    record_depth_pyramid_commands(cmdbuf);
+                })
+                .read(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT)
+                .write(pyramid, VK_IMAGE_LAYOUT_GENERAL,
+                       VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT, true);
+        // Writes the draw buffers of the scene pass, which depends on it.
+        graph->add_pass("cull", [this](const CommandBuffer &cmdbuf, uint32_t image_index) {
+                    record_cull_commands(cmdbuf, image_index);
+                })
+                .read(pyramid, VK_IMAGE_LAYOUT_GENERAL,
+                      VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    }
+    // The attachments are cleared, so their previous contents are discarded.
+    // The reading of the depth happens in the
+    // VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT stage and the writing in the
+    // VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT.
+    RenderGraphPass &scene_pass = graph->add_pass("scene", [this](const CommandBuffer &cmdbuf, uint32_t image_index) {
+                record_scene_pass(cmdbuf, image_index);
+            })
+            .write(scene, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                   VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true)
+            .write(depth, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                   VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                   VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, true);
+    // The indirect commands and the draw count are written by the cull pass.
+    if (_gpu_culling) scene_pass.depend_on("cull");
+    if (color) {
+        scene_pass.write(*color, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT, true);
+    }
+    // Writes the swap chain image.
+    graph->add_pass("present", [this](const CommandBuffer &cmdbuf, uint32_t image_index) {
+                record_present_blit(cmdbuf, image_index);
+            })
+            .read(scene, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                  VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT)
+            .set_side_effects();
+    graph->compile();
+
+    _scene_image = &graph->get_image(scene);
+    _scene_image_view = std::make_unique<ImageView>(*_device,
+            _scene_image->get_native(), color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    _color_image = color ? &graph->get_image(*color) : nullptr;
+    if (_color_image) {
+        _color_image_view = std::make_unique<ImageView>(*_device,
+                _color_image->get_native(), color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+    }
+    _depth_image = &graph->get_image(depth);
+    _depth_image_view = std::make_unique<ImageView>(*_device,
+            _depth_image->get_native(), depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
+    _render_graph = std::move(graph);
+    if (REPORT_ATTACHMENT_MEMORY) report_attachment_memory();
+}
 
-    std::tie(_color_image, _color_image_memory) = create_image(
-            extent.width, extent.height,
-            1, _msaa_samples, color_format,
-            VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT | VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+void vktest::Application::report_attachment_memory () const {
+    const RenderGraphStats &stats = _render_graph->get_stats();
+    // Lazily allocated memory is committed on demand, if at all, so the
+    // rest of it is saved as well.
+    VkDeviceSize committed = _render_graph->get_committed_lazy_size();
+    VkDeviceSize saved = stats.transient_size - stats.transient_allocated_size
+                       + stats.lazy_size - std::min(committed, stats.lazy_size);
+    std::cout << "Attachments: " << stats.transient_allocated_size << " bytes allocated for "
+              << stats.transient_size << " bytes of transient images, "
+              << stats.lazy_size << " bytes lazily allocated with "
+              << committed << " bytes committed, "
+              << saved << " bytes saved" << std::endl;
+}
 
-    _color_image_view = std::make_unique<ImageView>(*_device,
-            _color_image->get_native(), color_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
+void vktest::Application::report_object_cache () const {
+    ObjectCacheStats stats = _object_cache->get_stats();
+    std::pair<const char*, const ObjectCacheCounts*> tables[] {
+        { "samplers", &stats.samplers },
+        { "descriptor set layouts", &stats.descriptor_set_layouts },
+        { "pipeline layouts", &stats.pipeline_layouts },
+        { "render passes", &stats.render_passes }
+    };
+    for (const auto &[name, counts] : tables) {
+        std::cout << "Object cache, " << name << ": " << counts->hits << " hits, "
+                  << counts->misses << " misses (" << counts->hit_rate() * 100.0 << "% hit rate), "
+                  << counts->objects << " cached" << std::endl;
+    }
 }
 
-void vktest::Application::create_depth_resources () {
-    VkFormat depth_format = find_depth_format();
+VkImageCreateInfo vktest::Application::prepare_attachment_info (VkFormat format,
+                                                                VkSampleCountFlagBits num_samples,
+                                                                VkImageUsageFlags usage) const noexcept {
+    // Sized for the window, only the render extent is used of it.
     const VkExtent2D &extent = _swap_chain->get_extent();
-    std::tie(_depth_image, _dpeth_image_memory) = create_image(
+    VkImageCreateInfo image_info {};
+    image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    image_info.imageType = VK_IMAGE_TYPE_2D;
+    image_info.format = format;
+    image_info.extent.width = extent.width;
+    image_info.extent.height = extent.height;
+    image_info.extent.depth = 1;
+    image_info.mipLevels = 1;
+    image_info.arrayLayers = 1;
+    image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+    image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image_info.usage = usage;
+    image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    image_info.samples = num_samples;
+    return image_info;
+}
+
+void vktest::Application::create_depth_pyramid () {
+    if (!_gpu_culling) return;
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_sampler));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_level_views));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_view));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_memory));
+    const VkExtent2D &extent = _swap_chain->get_extent();
+    // The first level matches the depth attachment, the last one is 1x1.
+    _depth_pyramid_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(extent.width, extent.height)))) + 1;
+    std::tie(_depth_pyramid, _depth_pyramid_memory) = create_image(
             extent.width, extent.height,
-            1, _msaa_samples, depth_format,
-            VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT,
+            _depth_pyramid_levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R32_SFLOAT,
+            VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    _depth_image_view = std::make_unique<ImageView>(*_device,
-            _depth_image->get_native(), depth_format, VK_IMAGE_ASPECT_DEPTH_BIT, 1);
-    transition_image_layout(*_depth_image, depth_format,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, 1);
+    _depth_pyramid_view = std::make_unique<ImageView>(*_device,
+            _depth_pyramid->get_native(), VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, _depth_pyramid_levels);
+
+    // Every level is written through its own view.
+    _depth_pyramid_level_views.reserve(_depth_pyramid_levels);
+    for (uint32_t i = 0; i < _depth_pyramid_levels; i++) {
+        _depth_pyramid_level_views.emplace_back(*_device,
+                _depth_pyramid->get_native(), VK_FORMAT_R32_SFLOAT, VK_IMAGE_ASPECT_COLOR_BIT, 1, i);
+    }
+
+    // The shaders only fetch texels, so neither filtering nor anisotropy.
+    AddressModes address_modes { VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE, VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE };
+    _depth_pyramid_sampler = _object_cache->get_sampler(
+            VK_FILTER_NEAREST, VK_FILTER_NEAREST,
+            address_modes, 0.0f, _depth_pyramid_levels);
 }
 
 VkFormat vktest::Application::find_depth_format () const {
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT;
+    if (_gpu_culling) features |= VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
     return find_supported_format(
         { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT },
         VK_IMAGE_TILING_OPTIMAL,
-        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT
+        features
     );
 }
 
-bool vktest::Application::has_stencil_component (VkFormat format) const noexcept {
-    return format == VK_FORMAT_D32_SFLOAT_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT;
-}
-
 VkFormat vktest::Application::find_supported_format (
     const std::vector<VkFormat>& candidates,
     VkImageTiling tiling,
@@ -237,41 +859,246 @@ VkFormat vktest::Application::find_supported_format (
     throw std::runtime_error("Failed to find supported format");
 }
 
-void vktest::Application::create_texture_image () {
-    int width, height, channels;
-    stbi_uc *pixels = stbi_load(TEXTURE_PATH, &width, &height, &channels, STBI_rgb_alpha);
-    if (!pixels) throw std::runtime_error("Failed to load texture image");
-    VkDeviceSize image_size = width * height * 4;
-    // log2 -> calculates how many times that dimension can be divided by 2.
-    _mip_levels = static_cast<uint32_t>(std::floor( std::log2(std::max(width, height)) ) + 1);
+void vktest::Application::create_texture_image (const TextureData &texture) {
+    // Compressed blocks cannot be blitted to generate the mip levels, and
+    // not every device samples every compression format (BC is rare on
+    // mobile GPUs), so those textures are decompressed instead.
+    if (is_block_compressed(texture.format)
+            && (texture.levels.size() == 1 || !can_sample_texture_format(texture.format))) {
+        create_texture_image(decompress_texture(*_device, texture));
+        return;
+    }
+    // BC7 and ETC2 have no decoder to fall back on.
+    if (is_block_format(texture.format) && !is_block_compressed(texture.format)) {
+        if (!can_sample_texture_format(texture.format)) {
+            throw std::runtime_error("Failed to create texture image, the format is unsupported on this device");
+        }
+        if (texture.levels.size() == 1) {
+            throw std::runtime_error("Failed to create texture image, the mip levels of a compressed format cannot be generated");
+        }
+    }
+    int32_t width = static_cast<int32_t>(texture.width);
+    int32_t height = static_cast<int32_t>(texture.height);
+    _texture_format = texture.format;
+    // Pre-generated levels are used as they are. Otherwise log2 calculates
+    // how many times the larger dimension can be divided by 2.
+    bool generate = texture.levels.size() == 1;
+    _mip_levels = generate ? static_cast<uint32_t>(std::floor( std::log2(std::max(width, height)) ) + 1)
+                           : static_cast<uint32_t>(texture.levels.size());
+
+    // The texels were decoded or read straight into the staging buffer, so
+    // there is nothing left to copy on the host.
+    // Blitting the generated levels also reads from the image.
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    if (generate) usage |= VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    std::tie(_texture_image, _texture_image_memory) = create_image(
+            texture.width,
+            texture.height,
+            _mip_levels, VK_SAMPLE_COUNT_1_BIT,
+            _texture_format,
+            VK_IMAGE_TILING_OPTIMAL,
+            usage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
 
-    std::unique_ptr<Buffer> staging_buffer;
-    std::unique_ptr<DeviceMemory> staging_buffer_memory;
-    std::tie(staging_buffer, staging_buffer_memory) = create_buffer(
-            image_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    // All stored levels in one copy, one region each.
+    std::vector<VkBufferImageCopy> regions (texture.levels.size());
+    for (uint32_t i = 0; i < regions.size(); i++) {
+        VkBufferImageCopy &region = regions[i];
+        region.bufferOffset = texture.levels[i].offset;
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = i;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+
+        region.imageOffset = { 0, 0, 0 };
+        region.imageExtent = { std::max(texture.width >> i, 1u), std::max(texture.height >> i, 1u), 1 };
+    }
+    // The copy transitions the copied levels to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+    // by itself.
+    copy_buffer_to_image(texture.staging->get_buffer(), *_texture_image, regions);
 
-    void *data = staging_buffer_memory->map(0, image_size);
-    std::memcpy(data, pixels, static_cast<size_t>(image_size));
-    staging_buffer_memory->unmap();
-    stbi_image_free(pixels);
+    if (!generate || _mip_levels == 1) {
+        transition_image_layout(*_texture_image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+        return;
+    }
+    // The generator picked for an earlier texture is kept as long as it
+    // supports this one. Every generator leaves the image in
+    // VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+    std::vector<MipGenerator> generators = get_mip_generators(_texture_format, _mip_levels);
+    bool supported = _mip_generator
+                  && std::find(generators.begin(), generators.end(), *_mip_generator) != generators.end();
+    if (!supported && MIP_GENERATION_SPEED_TEST && generators.size() > 1) {
+        _mip_generator = time_mip_generators(texture, generators);
+        return;
+    }
+    if (!supported) _mip_generator = generators[0];
+    generate_texture_mipmaps(*_mip_generator, texture,
+                             prepare_mip_generation(*_mip_generator, _texture_format,
+                                                    texture.width, texture.height, _mip_levels));
+}
 
-    std::tie(_texture_image, _texture_image_memory) = create_image(
-            static_cast<uint32_t>(width),
-            static_cast<uint32_t>(height),
-            _mip_levels, VK_SAMPLE_COUNT_1_BIT,
-            VK_FORMAT_R8G8B8A8_SRGB,
+bool vktest::Application::can_sample_texture_format (VkFormat format) const {
+    VkFormatFeatureFlags features = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    return (_physical_device->get_format_properties(format).optimalTilingFeatures & features) == features;
+}
+
+std::vector<vktest::MipGenerator> vktest::Application::get_mip_generators (VkFormat format, uint32_t mip_levels) const {
+    std::vector<MipGenerator> generators {};
+    // Blitting filters linearly from one level of the image to the next.
+    VkFormatFeatureFlags blit_features = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT
+                                       | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+    if ((_physical_device->get_format_properties(format).optimalTilingFeatures & blit_features) == blit_features) {
+        generators.push_back(MipGenerator::blit);
+    }
+    // The other two work on 8-bit RGBA texels, the compute shader in an
+    // RGBA8 UNORM copy of the image.
+    bool rgba8 = format == VK_FORMAT_R8G8B8A8_SRGB || format == VK_FORMAT_R8G8B8A8_UNORM;
+    if (rgba8 && _mip_generation_pipeline && mip_levels <= MIP_GENERATION_MAX_LEVELS) {
+        generators.push_back(MipGenerator::compute);
+    }
+    if (rgba8) generators.push_back(MipGenerator::cpu);
+    if (generators.empty()) throw std::runtime_error("Failed to find a way to generate the mip levels of the texture");
+    return generators;
+}
+
+// The time is measured on the host, from recording the commands to their
+// completion, since that is what loading the texture waits for. The first
+// run builds what is built on first use, such as the lookup tables of the
+// CPU generator, and warms the caches, so that the order of the generators
+// does not matter.
+vktest::MipGenerator vktest::Application::time_mip_generators (const TextureData &texture,
+                                                               const std::vector<MipGenerator> &generators) {
+    MipGenerator fastest = generators[0];
+    double fastest_time = std::numeric_limits<double>::max();
+    for (MipGenerator generator : generators) {
+        MipGenerationResources resources = prepare_mip_generation(generator, _texture_format,
+                                                                  texture.width, texture.height, _mip_levels);
+        generate_texture_mipmaps(generator, texture, resources);
+        auto start = std::chrono::steady_clock::now();
+        generate_texture_mipmaps(generator, texture, resources);
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (REPORT_MIP_GENERATION) {
+            std::cout << "Mip generation (" << get_mip_generator_name(generator) << "): "
+                      << time << " ms for " << texture.width << "x" << texture.height << std::endl;
+        }
+        if (time < fastest_time) {
+            fastest = generator;
+            fastest_time = time;
+        }
+    }
+    return fastest;
+}
+
+vktest::MipGenerationResources vktest::Application::prepare_mip_generation (MipGenerator generator,
+                                                                           VkFormat image_format,
+                                                                           uint32_t width,
+                                                                           uint32_t height,
+                                                                           uint32_t mip_levels) const {
+    MipGenerationResources resources {};
+    if (generator == MipGenerator::cpu) {
+        size_t size = 0;
+        for (uint32_t i = 1; i < mip_levels; i++) {
+            VkBufferImageCopy region {};
+            region.bufferOffset = size;
+            region.bufferRowLength = 0;
+            region.bufferImageHeight = 0;
+            region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+            region.imageOffset = { 0, 0, 0 };
+            region.imageExtent = { std::max(width >> i, 1u), std::max(height >> i, 1u), 1 };
+            size += get_level_size(image_format, region.imageExtent.width, region.imageExtent.height);
+            resources.regions.push_back(region);
+        }
+        resources.staging = std::make_unique<StagingBuffer>(*_device, size);
+        return resources;
+    }
+    if (generator != MipGenerator::compute) return resources;
+
+    // sRGB formats rarely support storage, so the levels are generated in an
+    // RGBA8 UNORM image, which has the same texel layout, and copied from
+    // there. Every level is written through its own view.
+    std::tie(resources.levels_image, resources.levels_image_memory) = create_image(
+            width, height,
+            mip_levels, VK_SAMPLE_COUNT_1_BIT, VK_FORMAT_R8G8B8A8_UNORM,
             VK_IMAGE_TILING_OPTIMAL,
-            VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+            VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    resources.level_views.reserve(mip_levels);
+    for (uint32_t i = 0; i < mip_levels; i++) {
+        resources.level_views.emplace_back(*_device,
+                resources.levels_image->get_native(), VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT, 1, i);
+    }
 
-    transition_image_layout(*_texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, _mip_levels);
-        copy_buffer_to_image(*staging_buffer, *_texture_image, static_cast<uint32_t>(width), static_cast<uint32_t>(height));
-    // Transitioned to *VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL* while generating mipmaps.
-    // transition_image_layout(*_texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    // Written before every dispatch, see *generate_mipmaps_with_compute*.
+    std::tie(resources.state_buffer, resources.state_buffer_memory) = create_buffer(
+            3 * sizeof(uint32_t),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
-    generate_mipmaps(*_texture_image, VK_FORMAT_R8G8B8A8_SRGB, width, height, _mip_levels);
+    // A set used once, from a pool of its own.
+    std::vector<VkDescriptorPoolSize> pool_sizes {
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MIP_GENERATION_MAX_LEVELS },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1 }
+    };
+    resources.descriptor_pool = std::make_unique<DescriptorPool>(*_device, 1, pool_sizes);
+    resources.descriptor_sets = resources.descriptor_pool->allocate_descriptor_sets(
+            { _mip_generation_descriptor_set_layout.get() });
+
+    // The bindings past the last level repeat it; the shader never accesses
+    // them.
+    std::vector<VkDescriptorImageInfo> level_infos (MIP_GENERATION_MAX_LEVELS);
+    for (uint32_t i = 0; i < MIP_GENERATION_MAX_LEVELS; i++) {
+        level_infos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        level_infos[i].imageView = resources.level_views[std::min(i, mip_levels - 1)].get_native();
+    }
+    VkDescriptorBufferInfo state_info {};
+    state_info.buffer = resources.state_buffer->get_native();
+    state_info.offset = 0;
+    state_info.range = 3 * sizeof(uint32_t);
+
+    std::vector<VkWriteDescriptorSet> descriptor_writes (2);
+    descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[0].dstSet = resources.descriptor_sets[0].get_native();
+    descriptor_writes[0].dstBinding = 0;
+    descriptor_writes[0].dstArrayElement = 0;
+    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    descriptor_writes[0].descriptorCount = MIP_GENERATION_MAX_LEVELS;
+    descriptor_writes[0].pImageInfo = level_infos.data();
+
+    descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[1].dstSet = resources.descriptor_sets[0].get_native();
+    descriptor_writes[1].dstBinding = 1;
+    descriptor_writes[1].dstArrayElement = 0;
+    descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptor_writes[1].descriptorCount = 1;
+    descriptor_writes[1].pBufferInfo = &state_info;
+
+    vkUpdateDescriptorSets(_device->get_native(),
+                           static_cast<uint32_t>(descriptor_writes.size()),
+                           descriptor_writes.data(),
+                           0, nullptr);
+    return resources;
+}
+
+void vktest::Application::generate_texture_mipmaps (MipGenerator generator,
+                                                    const TextureData &texture,
+                                                    const MipGenerationResources &resources) {
+    switch (generator) {
+        case MipGenerator::blit:
+            generate_mipmaps(*_texture_image, _texture_format,
+                             static_cast<int32_t>(texture.width), static_cast<int32_t>(texture.height), _mip_levels);
+            break;
+        case MipGenerator::compute:
+            generate_mipmaps_with_compute(*_texture_image, _texture_format, texture.width, texture.height, _mip_levels,
+                                          resources);
+            break;
+        case MipGenerator::cpu:
+            generate_mipmaps_on_cpu(*_texture_image, texture, resources);
+            break;
+    }
 }
 
 void vktest::Application::generate_mipmaps (const Image &image,
@@ -288,36 +1115,17 @@ void vktest::Application::generate_mipmaps (const Image &image,
     // Check if image format supports linear blitting
     VkFormatProperties format_props = _physical_device->get_format_properties(image_format);
     if ( !(format_props.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ) {
-        // In this case, you could implement the mipmap generation in software
-        // with a library like stb_image_resize.
+        // In this case the levels are generated by the other generators, see
+        // *get_mip_generators*.
         throw std::runtime_error("Texture image format does not support linear blitting");
     }
 
     CommandBuffer cmdbuf = begin_single_time_commands();
 
-    std::vector<VkImageMemoryBarrier> barriers (1);
-    VkImageMemoryBarrier &barrier = barriers[0];
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    barrier.image = image.get_native();
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-    barrier.subresourceRange.levelCount = 1;
-
     int32_t mip_width = width;
     int32_t mip_height = height;
 
     for (uint32_t i = 1;i < mip_levels; i++) {
-        barrier.subresourceRange.baseMipLevel = i - 1;
-
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        cmdbuf.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, barriers);
-
         // Region(s) that will be used in the blit operation.
         std::vector<VkImageBlit> blits (1);
         VkImageBlit &blit = blits[0];
@@ -335,31 +1143,101 @@ void vktest::Application::generate_mipmaps (const Image &image,
         blit.dstSubresource.layerCount = 1;
         // NOTE: Beware if you are using a dedicated transfer queue:
         // *vkCmdBlitImage* must be submitted to a queue with graphics capability.
+        // The blit moves level i - 1 to VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL
+        // and level i to VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL on its own.
         cmdbuf.blit_image(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
                           image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
                           blits, VK_FILTER_LINEAR);
 
-        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
-        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        // This transition waits on the current blit command to finish. All
-        // sampling operations will wait on this transition to finish.
-        cmdbuf.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, barriers);
-
         if (mip_width > 1) mip_width /= 2;
         if (mip_height > 1) mip_height /= 2;
     }
 
-    barrier.subresourceRange.baseMipLevel = mip_levels - 1;
-    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-    // This barrier transitions the last mip level from VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
-    // to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. This wasn't handled by the loop.
-    cmdbuf.pipeline_barrier(VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, barriers);
+    // All levels are now either VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL or, for
+    // the last one, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL. A single batch of
+    // barriers moves them to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL. All
+    // sampling operations will wait on this transition to finish.
+    cmdbuf.transition_image(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    cmdbuf.flush_barriers();
+
+    end_single_time_commands( std::move(cmdbuf) );
+}
+
+void vktest::Application::generate_mipmaps_with_compute (const Image &image,
+                                                         VkFormat image_format,
+                                                         uint32_t width,
+                                                         uint32_t height,
+                                                         uint32_t mip_levels,
+                                                         const MipGenerationResources &resources) const {
+    // The level count, whether to convert from and to sRGB, and the count of
+    // finished work groups, see data/mip_generate.comp.
+    uint32_t state[3] { mip_levels, image_format == VK_FORMAT_R8G8B8A8_SRGB ? 1u : 0u, 0 };
+    void *data = resources.state_buffer_memory->map(0, sizeof(state));
+    std::memcpy(data, state, sizeof(state));
+    resources.state_buffer_memory->unmap();
+    const Image &levels_image = *resources.levels_image;
+
+    std::vector<VkImageCopy> copies (mip_levels);
+    for (uint32_t i = 0; i < mip_levels; i++) {
+        VkImageCopy &copy = copies[i];
+        copy.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+        copy.srcOffset = { 0, 0, 0 };
+        copy.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, i, 0, 1 };
+        copy.dstOffset = { 0, 0, 0 };
+        copy.extent = { std::max(width >> i, 1u), std::max(height >> i, 1u), 1 };
+    }
+
+    CommandBuffer cmdbuf = begin_single_time_commands();
+    // The base level in, the others are overwritten by the shader.
+    cmdbuf.copy_image(image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      levels_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      { copies[0] });
+    cmdbuf.transition_image(levels_image, VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                            false, VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 });
+    cmdbuf.transition_image(levels_image, VK_IMAGE_LAYOUT_GENERAL,
+                            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+                            true, VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 1, mip_levels - 1, 0, 1 });
+    cmdbuf.flush_barriers();
+
+    cmdbuf.bind_pipeline(*_mip_generation_pipeline);
+    std::vector<VkDescriptorSet> native_sets { resources.descriptor_sets[0].get_native() };
+    cmdbuf.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, *_mip_generation_pipeline_layout, 0, native_sets);
+    // A work group of 16x16 per 16x16 texels of the first generated level.
+    uint32_t level_width = std::max(width / 2, 1u);
+    uint32_t level_height = std::max(height / 2, 1u);
+    cmdbuf.dispatch((level_width + 15) / 16, (level_height + 15) / 16, 1);
+
+    // And the generated levels out.
+    cmdbuf.copy_image(levels_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      std::vector<VkImageCopy>(copies.begin() + 1, copies.end()));
+    cmdbuf.transition_image(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    cmdbuf.flush_barriers();
+
+    end_single_time_commands( std::move(cmdbuf) );
+}
+
+void vktest::Application::generate_mipmaps_on_cpu (const Image &image,
+                                                   const TextureData &texture,
+                                                   const MipGenerationResources &resources) const {
+    // Levels 1 and on are generated straight into the staging buffer. The
+    // base level is read back from the staging buffer of the texture, once
+    // and in order, which the loader places in cached memory where it can.
+    std::vector<unsigned char*> levels {};
+    for (const VkBufferImageCopy &region : resources.regions) {
+        levels.push_back(resources.staging->get_data() + region.bufferOffset);
+    }
+    generate_mip_levels(texture.format, texture.staging->get_data() + texture.levels[0].offset,
+                        texture.width, texture.height, levels);
 
+    CommandBuffer cmdbuf = begin_single_time_commands();
+    cmdbuf.copy_buffer(resources.staging->get_buffer(), image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, resources.regions);
+    cmdbuf.transition_image(image, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                            VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT);
+    cmdbuf.flush_barriers();
     end_single_time_commands( std::move(cmdbuf) );
 }
 
@@ -411,104 +1289,34 @@ vktest::Application::create_image (
 
 void vktest::Application::transition_image_layout (
         const Image &image,
-        VkFormat format,
-        VkImageLayout old_layout,
         VkImageLayout new_layout,
-        uint32_t mip_levels) const {
+        VkPipelineStageFlags stages,
+        VkAccessFlags access) const {
     CommandBuffer cmdbuf = begin_single_time_commands();
-
-    std::vector<VkImageMemoryBarrier> barriers (1);
-    VkImageMemoryBarrier &barrier = barriers[0];
-    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
-    // It is possible to use *VK_IMAGE_LAYOUT_UNDEFINED* as oldLayout if you
-    // don't care about the existing contents of the image.
-    barrier.oldLayout = old_layout;
-    barrier.newLayout = new_layout;
-
-    // If you are using the barrier to transfer queue family ownership, then
-    // these two fields should be the indices of the queue families. They must
-    // be set to VK_QUEUE_FAMILY_IGNORED if you don't want to do this.
-    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-
-    // The image and subresourceRange specify the image that is affected and
-    // the specific part of the image.
-    barrier.image = image.get_native();
-
-    if (new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-        if (has_stencil_component(format)) {
-            barrier.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
-        }
-    } else {
-        barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    }
-
-    barrier.subresourceRange.baseMipLevel = 0;
-    // The number of mipmap levels (starting from baseMipLevel) accessible to the view.
-    barrier.subresourceRange.levelCount = mip_levels;
-    barrier.subresourceRange.baseArrayLayer = 0;
-    barrier.subresourceRange.layerCount = 1;
-
-    VkPipelineStageFlags source_stage;
-    VkPipelineStageFlags destination_stage;
-
-    if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-        // Command buffer submission results in implicit VK_ACCESS_HOST_WRITE_BIT
-        // synchronization at the beginning.
-        barrier.srcAccessMask = 0;
-        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destination_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-    } else if (old_layout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && new_layout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
-        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        source_stage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-        destination_stage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-    } else if (old_layout == VK_IMAGE_LAYOUT_UNDEFINED && new_layout == VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) {
-        barrier.srcAccessMask = 0;
-        // The reading happens in the VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT
-        // stage and the writing in the VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT.
-        barrier.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        source_stage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-        destination_stage = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-    } else {
-        throw std::invalid_argument("Unsupported layout transition");
-    }
-
-    cmdbuf.pipeline_barrier(source_stage, destination_stage, 0, barriers);
+    // The image knows its current layout and last access, so the source half
+    // of the barrier is derived from that. Command buffer submission results
+    // in implicit VK_ACCESS_HOST_WRITE_BIT synchronization at the beginning.
+    cmdbuf.transition_image(image, new_layout, stages, access);
+    cmdbuf.flush_barriers();
     end_single_time_commands( std::move(cmdbuf) );
 }
 
 void vktest::Application::copy_buffer_to_image (
         const Buffer &buffer,
         const Image &image,
-        uint32_t width,
-        uint32_t height) const {
+        const std::vector<VkBufferImageCopy> &regions) const {
     CommandBuffer cmdbuf = begin_single_time_commands();
-
-    std::vector<VkBufferImageCopy> regions (1);
-    VkBufferImageCopy &region = regions[0];
-    region.bufferOffset = 0;
-    region.bufferRowLength = 0;
-    region.bufferImageHeight = 0;
-
-    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-    region.imageSubresource.mipLevel = 0;
-    region.imageSubresource.baseArrayLayer = 0;
-    region.imageSubresource.layerCount = 1;
-
-    region.imageOffset = { 0, 0, 0 };
-    region.imageExtent = { width, height, 1 };
-
     cmdbuf.copy_buffer(buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, regions);
     end_single_time_commands( std::move(cmdbuf) );
 }
 
-VkSampleCountFlagBits vktest::Application::get_max_usable_sample_count () const noexcept {
+VkSampleCountFlagBits vktest::Application::get_usable_sample_count (VkSampleCountFlagBits max_samples) const noexcept {
     VkPhysicalDeviceProperties props = _physical_device->get_properties();
 
     VkSampleCountFlags counts = props.limits.framebufferColorSampleCounts & props.limits.framebufferDepthSampleCounts;
+    // Sample count bits are powers of two, so this keeps the counts up to
+    // *max_samples*.
+    counts &= (max_samples << 1) - 1;
     if (counts & VK_SAMPLE_COUNT_64_BIT) { return VK_SAMPLE_COUNT_64_BIT; }
     if (counts & VK_SAMPLE_COUNT_32_BIT) { return VK_SAMPLE_COUNT_32_BIT; }
     if (counts & VK_SAMPLE_COUNT_16_BIT) { return VK_SAMPLE_COUNT_16_BIT; }
@@ -520,179 +1328,426 @@ VkSampleCountFlagBits vktest::Application::get_max_usable_sample_count () const
 
 void vktest::Application::create_texture_image_view () {
     _texture_image_view = std::make_unique<ImageView>(*_device,
-            _texture_image->get_native(), VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT, _mip_levels);
+            _texture_image->get_native(), _texture_format, VK_IMAGE_ASPECT_COLOR_BIT, _mip_levels);
 }
 
 void vktest::Application::create_texture_sampler () {
+    _deletion_queue.retire(_frame_number, std::move(_texture_sampler));
     AddressModes address_modes { VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT, VK_SAMPLER_ADDRESS_MODE_REPEAT };
-    _texture_sampler = std::make_unique<Sampler>(*_device,
+    _texture_sampler = _object_cache->get_sampler(
             VK_FILTER_LINEAR, VK_FILTER_LINEAR,
             address_modes,
-            _physical_device->get_properties().limits.maxSamplerAnisotropy,
+            std::min(quality_profiles[_quality_profile].max_anisotropy,
+                     _physical_device->get_properties().limits.maxSamplerAnisotropy),
             _mip_levels);
 }
 
-void vktest::Application::load_model () {
-    /* An OBJ file consists of positions, normals, texture coordinates and
-     * faces. Faces consist of an arbitrary amount of vertices, where each
-     * vertex refers to a position, normal and/or texture coordinate by index.
-     */
+void vktest::Application::create_bindless_descriptor_set () {
+    if (!_bindless) return;
+    // The set outlives the swap chain, so it has a pool of its own.
+    std::vector<VkDescriptorPoolSize> pool_sizes { { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, BINDLESS_TEXTURE_COUNT } };
+    _bindless_descriptor_pool = std::make_unique<DescriptorPool>(*_device, 1, pool_sizes,
+                                                                 VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+    _bindless_descriptor_set = std::make_unique<DescriptorSet>(*_bindless_descriptor_pool, *_bindless_descriptor_set_layout);
+    _bindless_texture_count = 0;
+    _texture_index = add_bindless_texture(*_texture_image_view);
+}
 
-    // attrib: Holds all of the positions, normals and texture coordinates in
-    // its attrib.vertices, attrib.normals and attrib.texcoords vectors.
-    tinyobj::attrib_t attrib;
-    // shapes: contains all of the separate objects and their faces.
-    std::vector<tinyobj::shape_t> shapes;
-    // a material and texture per face, but we will be ignoring those.
-    std::vector<tinyobj::material_t> materials;
-    std::string warn, err;
-
-    // Faces in OBJ files can actually contain an arbitrary number of vertices,
-    // whereas our application can only render triangles. Luckily the LoadObj
-    // has an optional parameter to automatically triangulate such faces, which
-    // is enabled by default.
-    bool res = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, MODEL_PATH);
-    if (!res) throw std::runtime_error(warn + err);
-
-    // Keep track of the unique vertices and respective indices.
-    std::unordered_map<Vertex, uint32_t> unique_vertices {};
-
-    for (const auto &shape : shapes) {
-        for (const auto &index : shape.mesh.indices) {
-            Vertex vertex {};
-            vertex.color = {1.0f, 1.0f, 1.0f};
-
-            vertex.pos = {
-                attrib.vertices[3 * index.vertex_index],
-                attrib.vertices[3 * index.vertex_index + 1],
-                attrib.vertices[3 * index.vertex_index + 2],
-            };
-
-            // The OBJ format assumes a coordinate system where a vertical
-            // coordinate of 0 means the bottom of the image, however we've
-            // uploaded our image into Vulkan in a top to bottom orientation
-            // where 0 means the top of the image.
-            vertex.tex_coord = {
-                attrib.texcoords[2 * index.texcoord_index],
-                1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
-            };
-
-            if (unique_vertices.count(vertex) == 0) {
-                unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
-                vertices.push_back(vertex);
-            }
-            indices.push_back(unique_vertices[vertex]);
-        }
+uint32_t vktest::Application::add_bindless_texture (const ImageView &view) {
+    if (_bindless_texture_count == BINDLESS_TEXTURE_COUNT) {
+        throw std::runtime_error("Failed to add texture, the bindless texture array is full");
     }
+    VkDescriptorImageInfo image_info {};
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = view.get_native();
+
+    VkWriteDescriptorSet descriptor_write {};
+    descriptor_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_write.dstSet = _bindless_descriptor_set->get_native();
+    descriptor_write.dstBinding = 0;
+    descriptor_write.dstArrayElement = _bindless_texture_count;
+    descriptor_write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    descriptor_write.descriptorCount = 1;
+    descriptor_write.pImageInfo = &image_info;
+    vkUpdateDescriptorSets(_device->get_native(), 1, &descriptor_write, 0, nullptr);
+    return _bindless_texture_count++;
 }
 
-void vktest::Application::create_vertex_buffer () {
-    VkDeviceSize buffer_size = sizeof(vertices[0]) * vertices.size();
+// Parsed and deduplicated on a worker thread, see *AssetLoader*.
+void vktest::Application::load_model (ModelData model) {
+    vertices = std::move(model.vertices);
+    indices = std::move(model.indices);
 
-    // Staging buffer: A host visible buffer as temporary buffer.
-    std::unique_ptr<Buffer> staging_buffer;
-    std::unique_ptr<DeviceMemory> staging_buffer_memory;
-    std::tie(staging_buffer, staging_buffer_memory) = create_buffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    build_lods();
+    build_meshlets();
+    create_instances();
+}
 
-    void *data = staging_buffer_memory->map(0, buffer_size);
-    std::memcpy(data, vertices.data(), static_cast<size_t>(buffer_size));
-    staging_buffer_memory->unmap();
+std::vector<glm::vec3> vktest::Application::get_positions () const {
+    std::vector<glm::vec3> positions (vertices.size());
+    std::transform(vertices.begin(), vertices.end(), positions.begin(), [](const Vertex &v) { return v.pos; });
+    return positions;
+}
 
-    // A device local one as actual vertex buffer.
-    // Device local buffer: That we're not able to use vkMapMemory. However, we
-    // can copy data from the staging buffer to the device local buffer.
-    std::tie(_vertex_buffer, _vertex_buffer_memory) = create_buffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    // Move the vertex data to the device local buffer.
-    copy_buffer(*staging_buffer, *_vertex_buffer, buffer_size);
+void vktest::Application::build_lods () {
+    std::vector<glm::vec3> positions = get_positions();
+    _bounding_sphere = compute_bounding_sphere(positions);
+
+    _lods.clear();
+    _lods.push_back({ 0, static_cast<uint32_t>(indices.size()), 0.0f, 0, 0 });
+
+    // Every level is simplified further from the previous one and appended
+    // to the index buffer; the vertex buffers are shared by all levels.
+    MeshSimplifier simplifier (positions, indices);
+    for (size_t i = 1; i < LOD_COUNT; i++) {
+        size_t target = static_cast<size_t>(_lods.back().index_count * LOD_REDUCTION) / 3 * 3;
+        if (!simplifier.simplify(target)) break;
+        const std::vector<uint32_t> &lod_indices = simplifier.get_indices();
+        _lods.push_back({ static_cast<uint32_t>(indices.size()),
+                          static_cast<uint32_t>(lod_indices.size()),
+                          simplifier.get_error(),
+                          0, 0 });
+        indices.insert(indices.end(), lod_indices.begin(), lod_indices.end());
+    }
 }
 
-void vktest::Application::create_index_buffer () {
-    VkDeviceSize buffer_size = sizeof(indices[0]) * indices.size();
+void vktest::Application::build_meshlets () {
+    std::vector<glm::vec3> positions = get_positions();
+    _meshlets.clear();
+    // Reorders the index range of every level so that its meshlets are
+    // contiguous; the levels themselves keep their ranges.
+    for (MeshLod &lod : _lods) {
+        std::vector<Meshlet> meshlets = vktest::build_meshlets(positions, indices,
+                lod.first_index, lod.index_count,
+                MESHLET_MAX_VERTICES, MESHLET_MAX_TRIANGLES);
+        lod.first_meshlet = static_cast<uint32_t>(_meshlets.size());
+        lod.meshlet_count = static_cast<uint32_t>(meshlets.size());
+        _meshlets.insert(_meshlets.end(), meshlets.begin(), meshlets.end());
+    }
+}
 
-    // Staging buffer: A host visible buffer as temporary buffer.
-    std::unique_ptr<Buffer> staging_buffer;
-    std::unique_ptr<DeviceMemory> staging_buffer_memory;
-    std::tie(staging_buffer, staging_buffer_memory) = create_buffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
-            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+void vktest::Application::create_instances () {
+    _instances.clear();
+    _instances.reserve(INSTANCE_GRID_SIZE * INSTANCE_GRID_SIZE);
+    // The grid is centered around the origin of the XY plane.
+    float offset = (INSTANCE_GRID_SIZE - 1) * INSTANCE_SPACING * 0.5f;
+    for (int y = 0; y < INSTANCE_GRID_SIZE; y++) {
+        for (int x = 0; x < INSTANCE_GRID_SIZE; x++) {
+            glm::vec3 translation (x * INSTANCE_SPACING - offset, y * INSTANCE_SPACING - offset, 0.0f);
+            glm::vec4 bounds (_bounding_sphere.center, _bounding_sphere.radius);
+            // The model has a single texture.
+            _instances.push_back({ glm::translate(glm::mat4(1.0f), translation), bounds, _texture_index, {} });
+        }
+    }
+}
 
-    void *data = staging_buffer_memory->map(0, buffer_size);
-    std::memcpy(data, indices.data(), (size_t) buffer_size);
-    staging_buffer_memory->unmap();
+bool vktest::Application::can_cull_on_gpu () const noexcept {
+    // A single instance is better served by the per-meshlet culling on the
+    // CPU.
+    if (_instances.size() <= 1) return false;
+    // One indirect draw per instance, each selecting its transform through
+    // firstInstance.
+    const DeviceFeatures &features = _device->get_features();
+    if (!features.multi_draw_indirect || !features.draw_indirect_first_instance) return false;
+    return _instances.size() <= _physical_device->get_properties().limits.maxDrawIndirectCount;
+}
 
-    // A device local one as actual vertex buffer.
-    // Device local buffer: That we're not able to use vkMapMemory. However, we
-    // can copy data from the staging buffer to the device local buffer.
-    std::tie(_index_buffer, _index_buffer_memory) = create_buffer(
-            buffer_size,
-            VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    // Move the vertex data to the device local buffer.
-    copy_buffer(*staging_buffer, *_index_buffer, buffer_size);
+size_t vktest::Application::select_lod (const glm::mat4 &model_view, const glm::mat4 &proj) const noexcept {
+    glm::vec4 center = model_view * glm::vec4(_bounding_sphere.center, 1.0f);
+    // Assumes the model matrix has a uniform scale.
+    float scale = glm::length(glm::vec3(model_view[0]));
+    float distance = glm::length(glm::vec3(center)) - _bounding_sphere.radius * scale;
+    if (distance <= 0.0f) return 0;
+
+    // proj[1][1] is cot(fovy / 2) (negated by the Y-flip), so this converts
+    // a length at the nearest point of the bounding sphere to pixels.
+    float pixels_per_unit = std::abs(proj[1][1]) * 0.5f * _render_extent.height / distance;
+    for (size_t i = _lods.size() - 1; i > 0; i--) {
+        if (_lods[i].error * scale * pixels_per_unit <= LOD_PIXEL_ERROR) return i;
+    }
+    return 0;
 }
 
-void vktest::Application::create_descriptor_pool () {
-    std::vector<VkDescriptorPoolSize> pool_sizes (2);
-    pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    pool_sizes[0].descriptorCount = static_cast<uint32_t>( _swap_chain->get_images().size() );
-    pool_sizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    pool_sizes[1].descriptorCount = static_cast<uint32_t>( _swap_chain->get_images().size() );
+uint32_t vktest::Application::cull_meshlets (uint32_t image_index,
+                                             const MeshLod &lod,
+                                             const glm::mat4 &model_view,
+                                             const glm::mat4 &proj) const {
+    // Culling happens in object space: the frustum planes are extracted from
+    // the full transform and the camera is moved into the model's space.
+    Frustum frustum = extract_frustum(proj * model_view);
+    glm::vec3 camera_position = glm::vec3(glm::inverse(model_view)[3]);
+
+    // Copies the indices of the surviving meshlets into a compacted index
+    // list; the GPU never sees the rejected triangles.
+    size_t idx = static_cast<size_t>(image_index);
+    uint32_t *data = static_cast<uint32_t*>(_visible_index_buffer_memories[idx]->map(0, VK_WHOLE_SIZE));
+    uint32_t index_count = 0;
+    for (uint32_t i = lod.first_meshlet; i < lod.first_meshlet + lod.meshlet_count; i++) {
+        const Meshlet &meshlet = _meshlets[i];
+        if (is_meshlet_backfacing(meshlet, camera_position)) continue;
+        if (!is_sphere_in_frustum(frustum, meshlet.bounds)) continue;
+        std::memcpy(data + index_count, &indices[meshlet.first_index], meshlet.index_count * sizeof(uint32_t));
+        index_count += meshlet.index_count;
+    }
+    _visible_index_buffer_memories[idx]->unmap();
+    return index_count;
+}
+
+std::vector<VkDrawIndexedIndirectCommand> vktest::Application::prepare_draws (uint32_t image_index,
+                                                                              const UniformBufferObject &ubo) const {
+    size_t idx = static_cast<size_t>(image_index);
+    InstanceData *data = static_cast<InstanceData*>(_instance_buffer_memories[idx]->map(0, VK_WHOLE_SIZE));
+    std::vector<VkDrawIndexedIndirectCommand> draws {};
+
+    if (_instances.size() == 1) {
+        // A single instance is culled per meshlet into the compacted index
+        // list that starts at index 0 of the visible index buffer.
+        data[0] = _instances[0];
+        _instance_buffer_memories[idx]->unmap();
+        glm::mat4 model_view = ubo.view * _instances[0].model * ubo.model;
+        const MeshLod &lod = _lods[ select_lod(model_view, ubo.proj) ];
+        uint32_t index_count = cull_meshlets(image_index, lod, model_view, ubo.proj);
+        if (index_count > 0) draws.push_back({ index_count, 1, 0, 0, 0 });
+        return draws;
+    }
 
-    uint32_t max_sets = static_cast<uint32_t>( _swap_chain->get_images().size() );
+    // Instances are culled as a whole and bucketed by level of detail, so
+    // every level in use is drawn with one instanced draw call.
+    Frustum frustum = extract_frustum(ubo.proj * ubo.view);
+    std::vector<std::vector<uint32_t>> buckets (_lods.size());
+    for (uint32_t i = 0; i < _instances.size(); i++) {
+        glm::mat4 model = _instances[i].model * ubo.model;
+        BoundingSphere bounds {
+            glm::vec3(model * glm::vec4(_bounding_sphere.center, 1.0f)),
+            _bounding_sphere.radius * glm::length(glm::vec3(model[0]))
+        };
+        if (!is_sphere_in_frustum(frustum, bounds)) continue;
+        buckets[ select_lod(ubo.view * model, ubo.proj) ].push_back(i);
+    }
+
+    uint32_t first_instance = 0;
+    for (size_t lod = 0; lod < buckets.size(); lod++) {
+        if (buckets[lod].empty()) continue;
+        uint32_t instance_count = static_cast<uint32_t>(buckets[lod].size());
+        for (uint32_t i = 0; i < instance_count; i++) {
+            data[first_instance + i] = _instances[ buckets[lod][i] ];
+        }
+        draws.push_back({ _lods[lod].index_count, instance_count, _lods[lod].first_index, 0, first_instance });
+        first_instance += instance_count;
+    }
+    _instance_buffer_memories[idx]->unmap();
+    return draws;
+}
+
+void vktest::Application::create_vertex_buffer () {
+    std::vector<glm::vec3> positions;
+    std::vector<VertexAttributes> attributes;
+    positions.reserve(vertices.size());
+    attributes.reserve(vertices.size());
+    for (const Vertex &vertex : vertices) {
+        positions.push_back(vertex.pos);
+        attributes.push_back(vertex.get_attributes());
+    }
+
+    std::tie(_position_buffer, _position_buffer_memory) = create_device_local_buffer(
+            positions.data(),
+            sizeof(positions[0]) * positions.size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    std::tie(_attribute_buffer, _attribute_buffer_memory) = create_device_local_buffer(
+            attributes.data(),
+            sizeof(attributes[0]) * attributes.size(),
+            VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+}
+
+void vktest::Application::create_index_buffer () {
+    std::tie(_index_buffer, _index_buffer_memory) = create_device_local_buffer(
+            indices.data(),
+            sizeof(indices[0]) * indices.size(),
+            VK_BUFFER_USAGE_INDEX_BUFFER_BIT);
+}
+
+void vktest::Application::create_descriptor_pool () {
+    // The scene sets come from the allocator of the frame.
+    if (!_gpu_culling) return;
+    uint32_t image_count = static_cast<uint32_t>( _swap_chain->get_images().size() );
+    // The culling sets take a uniform buffer, four storage buffers and the
+    // depth pyramid per image, plus one set per level of the pyramid.
+    std::vector<VkDescriptorPoolSize> pool_sizes {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, image_count },
+        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, image_count + _depth_pyramid_levels },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 * image_count },
+        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, _depth_pyramid_levels }
+    };
+    uint32_t max_sets = image_count + _depth_pyramid_levels;
     _descriptor_pool = std::make_unique<DescriptorPool>(*_device, max_sets, pool_sizes);
 }
 
-void vktest::Application::create_descriptor_sets () {
-    std::vector<DescriptorSetLayout*> layouts (_swap_chain->get_images().size(), _descriptor_set_layout.get());
-    _descriptor_sets = _descriptor_pool->allocate_descriptor_sets(layouts);
+void vktest::Application::create_descriptor_allocators () {
+    if (_push_descriptors) return;
+    // The scene set takes a uniform buffer and the texture, or only the
+    // sampler with bindless textures.
+    std::vector<VkDescriptorPoolSize> sizes_per_set {
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1 },
+        { _bindless ? VK_DESCRIPTOR_TYPE_SAMPLER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }
+    };
+    _descriptor_allocators.clear();
+    _descriptor_allocators.reserve(MAX_FRAMES_IN_FLIGHT);
+    for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        _descriptor_allocators.emplace_back(*_device, sizes_per_set, DESCRIPTOR_ALLOCATOR_SET_COUNT);
+    }
+}
+
+// The writes of the scene set, which refer to *buffer_info* and
+// *image_info*. *set* is ignored when the writes are pushed.
+std::vector<VkWriteDescriptorSet> vktest::Application::scene_descriptor_writes (uint32_t image_index,
+                                                                                VkDescriptorSet set,
+                                                                                VkDescriptorBufferInfo &buffer_info,
+                                                                                VkDescriptorImageInfo &image_info) const {
+    size_t i = static_cast<size_t>(image_index);
+
+    // Specifies the buffer that the descriptors refer, and the region
+    // within it that contains the data for the descriptor.
+    buffer_info = {};
+    buffer_info.buffer = _uniform_buffers[i]->get_native();
+    buffer_info.offset = 0;
+    buffer_info.range = sizeof(UniformBufferObject); // VK_WHOLE_SIZE is also possible
+
+    // The bindless textures are in their own set.
+    image_info = {};
+    image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    image_info.imageView = _bindless ? VK_NULL_HANDLE : _texture_image_view->get_native();
+    image_info.sampler = _texture_sampler->get_native();
+
+    // The configuration of descriptors
+    std::vector<VkWriteDescriptorSet> descriptor_writes (2);
+
+    descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[0].dstSet = set;
+    descriptor_writes[0].dstBinding = 0;
+    // The first index in the array that we want to update.
+    descriptor_writes[0].dstArrayElement = 0;
+    descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    descriptor_writes[0].descriptorCount = 1;
+    // An array with descriptorCount structs. Other type fields are ignored.
+    descriptor_writes[0].pBufferInfo = &buffer_info;
+    descriptor_writes[0].pImageInfo = nullptr; // Optional
+    descriptor_writes[0].pTexelBufferView = nullptr; // Optional
+
+    descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptor_writes[1].dstSet = set;
+    descriptor_writes[1].dstBinding = 1;
+    descriptor_writes[1].dstArrayElement = 0;
+    descriptor_writes[1].descriptorType = _bindless ? VK_DESCRIPTOR_TYPE_SAMPLER : VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptor_writes[1].descriptorCount = 1;
+    descriptor_writes[1].pImageInfo = &image_info;
+    return descriptor_writes;
+}
+
+// The set is allocated anew every frame, so it always refers to the current
+// uniform buffer and sampler, and is returned when the allocator of the frame
+// is reset.
+void vktest::Application::update_scene_descriptor_set (uint32_t image_index) {
+    if (_push_descriptors) return;
+    _scene_descriptor_set = _descriptor_allocators[_current_frame].allocate(*_descriptor_set_layout);
+
+    VkDescriptorBufferInfo buffer_info {};
+    VkDescriptorImageInfo image_info {};
+    std::vector<VkWriteDescriptorSet> descriptor_writes =
+        scene_descriptor_writes(image_index, _scene_descriptor_set, buffer_info, image_info);
+
+    // vkUpdateDescriptorSets accepts two kinds of arrays as parameters:
+    // an array of *VkWriteDescriptorSet* and an array of
+    // *VkCopyDescriptorSet*. The latter can be used to copy descriptors to
+    // each other.
+    vkUpdateDescriptorSets(_device->get_native(),
+                           static_cast<uint32_t>(descriptor_writes.size()),
+                           descriptor_writes.data(),
+                           0, nullptr);
+}
+
+void vktest::Application::create_cull_descriptor_sets () {
+    if (!_gpu_culling) return;
+    std::vector<DescriptorSetLayout*> layouts (_swap_chain->get_images().size(), _cull_descriptor_set_layout.get());
+    _cull_descriptor_sets = _descriptor_pool->allocate_descriptor_sets(layouts);
 
     for (size_t i = 0; i < _swap_chain->get_images().size(); i++) {
-        // Specifies the buffer that the descriptors refer, and the region
-        // within it that contains the data for the descriptor.
-        VkDescriptorBufferInfo buffer_info {};
-        buffer_info.buffer = _uniform_buffers[i]->get_native();
-        buffer_info.offset = 0;
-        buffer_info.range = sizeof(UniformBufferObject); // VK_WHOLE_SIZE is also possible
-
-        VkDescriptorImageInfo image_info {};
-        image_info.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-        image_info.imageView = _texture_image_view->get_native();
-        image_info.sampler = _texture_sampler->get_native();
-
-        // The configuration of descriptors
-        std::vector<VkWriteDescriptorSet> descriptor_writes (2);
+        std::vector<VkDescriptorBufferInfo> buffer_infos {
+            { _cull_uniform_buffers[i]->get_native(), 0, sizeof(CullUniforms) },
+            { _object_buffer->get_native(), 0, VK_WHOLE_SIZE },
+            { _lod_buffer->get_native(), 0, VK_WHOLE_SIZE },
+            { _draw_command_buffers[i]->get_native(), 0, VK_WHOLE_SIZE },
+            { _draw_count_buffers[i]->get_native(), 0, VK_WHOLE_SIZE }
+        };
+
+        VkDescriptorImageInfo pyramid_info {};
+        pyramid_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        pyramid_info.imageView = _depth_pyramid_view->get_native();
+        pyramid_info.sampler = _depth_pyramid_sampler->get_native();
+
+        std::vector<VkWriteDescriptorSet> descriptor_writes (buffer_infos.size() + 1);
+        for (size_t j = 0; j < buffer_infos.size(); j++) {
+            descriptor_writes[j].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptor_writes[j].dstSet = _cull_descriptor_sets[i].get_native();
+            descriptor_writes[j].dstBinding = static_cast<uint32_t>(j);
+            descriptor_writes[j].dstArrayElement = 0;
+            descriptor_writes[j].descriptorType = j == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptor_writes[j].descriptorCount = 1;
+            descriptor_writes[j].pBufferInfo = &buffer_infos[j];
+        }
+        VkWriteDescriptorSet &pyramid_write = descriptor_writes.back();
+        pyramid_write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        pyramid_write.dstSet = _cull_descriptor_sets[i].get_native();
+        pyramid_write.dstBinding = 5;
+        pyramid_write.dstArrayElement = 0;
+        pyramid_write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        pyramid_write.descriptorCount = 1;
+        pyramid_write.pImageInfo = &pyramid_info;
+        vkUpdateDescriptorSets(_device->get_native(),
+                               static_cast<uint32_t>(descriptor_writes.size()),
+                               descriptor_writes.data(),
+                               0, nullptr);
+    }
+}
+
+void vktest::Application::create_depth_pyramid_descriptor_sets () {
+    if (!_gpu_culling) return;
+    std::vector<DescriptorSetLayout*> layouts (_depth_pyramid_levels, _depth_pyramid_descriptor_set_layout.get());
+    _depth_pyramid_descriptor_sets = _descriptor_pool->allocate_descriptor_sets(layouts);
+
+    for (uint32_t i = 0; i < _depth_pyramid_levels; i++) {
+        // The first level reads the depth attachment, the others the level
+        // below.
+        VkDescriptorImageInfo source_info {};
+        source_info.sampler = _depth_pyramid_sampler->get_native();
+        if (i == 0) {
+            source_info.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+            source_info.imageView = _depth_image_view->get_native();
+        } else {
+            source_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            source_info.imageView = _depth_pyramid_level_views[i - 1].get_native();
+        }
 
+        VkDescriptorImageInfo destination_info {};
+        destination_info.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+        destination_info.imageView = _depth_pyramid_level_views[i].get_native();
+
+        std::vector<VkWriteDescriptorSet> descriptor_writes (2);
         descriptor_writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_writes[0].dstSet = _descriptor_sets[i].get_native();
+        descriptor_writes[0].dstSet = _depth_pyramid_descriptor_sets[i].get_native();
         descriptor_writes[0].dstBinding = 0;
-        // The first index in the array that we want to update.
         descriptor_writes[0].dstArrayElement = 0;
-        descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptor_writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
         descriptor_writes[0].descriptorCount = 1;
-        // An array with descriptorCount structs. Other type fields are ignored.
-        descriptor_writes[0].pBufferInfo = &buffer_info;
-        descriptor_writes[0].pImageInfo = nullptr; // Optional
-        descriptor_writes[0].pTexelBufferView = nullptr; // Optional
+        descriptor_writes[0].pImageInfo = &source_info;
 
         descriptor_writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptor_writes[1].dstSet = _descriptor_sets[i].get_native();
+        descriptor_writes[1].dstSet = _depth_pyramid_descriptor_sets[i].get_native();
         descriptor_writes[1].dstBinding = 1;
         descriptor_writes[1].dstArrayElement = 0;
-        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        descriptor_writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
         descriptor_writes[1].descriptorCount = 1;
-        descriptor_writes[1].pImageInfo = &image_info;
+        descriptor_writes[1].pImageInfo = &destination_info;
 
-        // vkUpdateDescriptorSets accepts two kinds of arrays as parameters:
-        // an array of *VkWriteDescriptorSet* and an array of
-        // *VkCopyDescriptorSet*. The latter can be used to copy descriptors to
-        // each other.
         vkUpdateDescriptorSets(_device->get_native(),
                                static_cast<uint32_t>(descriptor_writes.size()),
                                descriptor_writes.data(),
@@ -712,6 +1767,77 @@ void vktest::Application::create_uniform_buffers () {
     }
 }
 
+void vktest::Application::create_visible_index_buffers () {
+    // Large enough for every triangle of the most detailed level.
+    VkDeviceSize buffer_size = sizeof(uint32_t) * _lods[0].index_count;
+    _visible_index_buffers.reserve( _swap_chain->get_images().size() );
+    _visible_index_buffer_memories.reserve( _swap_chain->get_images().size() );
+
+    for (size_t i = 0; i < _swap_chain->get_images().size(); i++) {
+        auto pair = create_buffer(buffer_size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _visible_index_buffers.push_back( std::move(pair.first) );
+        _visible_index_buffer_memories.push_back( std::move(pair.second) );
+    }
+}
+
+void vktest::Application::create_instance_buffers () {
+    // The GPU-driven path reads the transforms from the object buffer.
+    if (_gpu_culling) return;
+    VkDeviceSize buffer_size = sizeof(InstanceData) * _instances.size();
+    _instance_buffers.reserve( _swap_chain->get_images().size() );
+    _instance_buffer_memories.reserve( _swap_chain->get_images().size() );
+
+    for (size_t i = 0; i < _swap_chain->get_images().size(); i++) {
+        auto pair = create_buffer(buffer_size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _instance_buffers.push_back( std::move(pair.first) );
+        _instance_buffer_memories.push_back( std::move(pair.second) );
+    }
+}
+
+void vktest::Application::create_scene_buffers () {
+    if (!_gpu_culling) return;
+    // The objects are read by the culling shader and, through firstInstance
+    // of the draw commands, as the per-instance vertex buffer.
+    std::tie(_object_buffer, _object_buffer_memory) = create_device_local_buffer(
+            _instances.data(),
+            sizeof(_instances[0]) * _instances.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT);
+    std::tie(_lod_buffer, _lod_buffer_memory) = create_device_local_buffer(
+            _lods.data(),
+            sizeof(_lods[0]) * _lods.size(),
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+}
+
+void vktest::Application::create_cull_buffers () {
+    if (!_gpu_culling) return;
+    size_t image_count = _swap_chain->get_images().size();
+    VkDeviceSize commands_size = sizeof(VkDrawIndexedIndirectCommand) * _instances.size();
+    _cull_uniform_buffers.reserve(image_count);
+    _cull_uniform_buffer_memories.reserve(image_count);
+    _draw_command_buffers.reserve(image_count);
+    _draw_command_buffer_memories.reserve(image_count);
+    _draw_count_buffers.reserve(image_count);
+    _draw_count_buffer_memories.reserve(image_count);
+
+    for (size_t i = 0; i < image_count; i++) {
+        auto uniform = create_buffer(sizeof(CullUniforms), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+        _cull_uniform_buffers.push_back( std::move(uniform.first) );
+        _cull_uniform_buffer_memories.push_back( std::move(uniform.second) );
+
+        // Written by the compute shader and consumed by the indirect draw,
+        // never touched by the host.
+        auto commands = create_buffer(commands_size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        _draw_command_buffers.push_back( std::move(commands.first) );
+        _draw_command_buffer_memories.push_back( std::move(commands.second) );
+
+        auto count = create_buffer(sizeof(uint32_t),
+                                   VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                   VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        _draw_count_buffers.push_back( std::move(count.first) );
+        _draw_count_buffer_memories.push_back( std::move(count.second) );
+    }
+}
+
 std::pair< std::unique_ptr<vktest::Buffer>, std::unique_ptr<vktest::DeviceMemory> >
 vktest::Application::create_buffer (VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) const {
     auto buffer = std::make_unique<Buffer>(*_device, size, usage, VK_SHARING_MODE_EXCLUSIVE);
@@ -732,6 +1858,27 @@ vktest::Application::create_buffer (VkDeviceSize size, VkBufferUsageFlags usage,
     return pair;
 }
 
+std::pair< std::unique_ptr<vktest::Buffer>, std::unique_ptr<vktest::DeviceMemory> >
+vktest::Application::create_device_local_buffer (const void *src_data, VkDeviceSize size, VkBufferUsageFlags usage) const {
+    // Staging buffer: A host visible buffer as temporary buffer.
+    std::unique_ptr<Buffer> staging_buffer;
+    std::unique_ptr<DeviceMemory> staging_buffer_memory;
+    std::tie(staging_buffer, staging_buffer_memory) = create_buffer(
+            size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    void *data = staging_buffer_memory->map(0, size);
+    std::memcpy(data, src_data, static_cast<size_t>(size));
+    staging_buffer_memory->unmap();
+
+    // Device local buffer: That we're not able to use vkMapMemory. However, we
+    // can copy data from the staging buffer to the device local buffer.
+    auto pair = create_buffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT | usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    copy_buffer(*staging_buffer, *pair.first, size);
+    return pair;
+}
+
 uint32_t vktest::Application::find_memory_type (uint32_t type_filter, VkMemoryPropertyFlags properties) const {
     // VkPhysicalDeviceMemoryProperties: Has two arrays *memoryTypes* and
     // *memoryHeaps*. Memory heaps are distinct memory resources like dedicated
@@ -798,40 +1945,269 @@ void vktest::Application::create_command_buffers () {
     _swap_chain->create_command_buffers(*_command_pool);
 }
 
-void vktest::Application::record_command_buffers () const {
-    std::vector<CommandBuffer*> cmdbufs = _swap_chain->get_command_buffers();
-    const std::vector<Framebuffer> &framebufs = _swap_chain->get_framebuffers();
+void vktest::Application::record_command_buffer (uint32_t image_index) const {
+    const CommandBuffer &cmdbuf = _swap_chain->get_command_buffer(image_index);
 
-    for (size_t i = 0; i < cmdbufs.size(); i++) {
-        const CommandBuffer &cmdbuf = *(cmdbufs[i]);
+    // Beginning a command buffer implicitly resets it.
+    cmdbuf.begin(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    if (_timestamp_query_pool) {
+        cmdbuf.reset_query_pool(*_timestamp_query_pool, image_index * 2, 2);
+        cmdbuf.write_timestamp(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, *_timestamp_query_pool, image_index * 2);
+    }
+    // The culling, the scene and the blit to the swap chain image, with the
+    // barriers between them.
+    _render_graph->execute(cmdbuf, image_index);
+    if (_timestamp_query_pool) {
+        cmdbuf.write_timestamp(VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, *_timestamp_query_pool, image_index * 2 + 1);
+    }
+    cmdbuf.end();
+}
 
-        cmdbuf.begin();
-        VkRect2D render_area { {0, 0}, _swap_chain->get_extent() };
-        cmdbuf.begin_render_pass(*_render_pass, framebufs[i], std::move(render_area));
-            cmdbuf.bind_pipeline(*_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS);
-            std::vector<VkBuffer> vertex_buffers { _vertex_buffer->get_native() };
-            std::vector<VkDeviceSize> offsets { 0 };
-            cmdbuf.bind_vertex_buffers(0, 1, vertex_buffers, offsets);
-            cmdbuf.bind_index_buffer(*_index_buffer, 0, VK_INDEX_TYPE_UINT32);
+void vktest::Application::record_scene_pass (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    // A single instance draws the meshlets that survived culling, a grid of
+    // instances draws whole levels of detail from the static index buffer.
+    const Buffer &index_buffer = _instances.size() == 1 ? *_visible_index_buffers[image_index] : *_index_buffer;
+    const Buffer &instance_buffer = _gpu_culling ? *_object_buffer : *_instance_buffers[image_index];
+
+    // Only the render extent of the attachments is cleared and drawn to.
+    VkRect2D render_area { {0, 0}, _render_extent };
+    begin_scene_rendering(cmdbuf, render_area);
+        VkViewport viewport { 0.0f, 0.0f, (float) _render_extent.width, (float) _render_extent.height, 0.0f, 1.0f };
+        cmdbuf.set_viewport(viewport);
+        cmdbuf.set_scissor(render_area);
+        // Binding 0 holds positions, binding 1 the other attributes and
+        // binding 2 the per-instance transforms. Bindings and descriptor sets
+        // stay bound across subpasses and pipelines.
+        std::vector<VkBuffer> vertex_buffers {
+            _position_buffer->get_native(),
+            _attribute_buffer->get_native(),
+            instance_buffer.get_native()
+        };
+        std::vector<VkDeviceSize> offsets { 0, 0, 0 };
+        cmdbuf.bind_vertex_buffers(0, 3, vertex_buffers, offsets);
+        cmdbuf.bind_index_buffer(index_buffer, 0, VK_INDEX_TYPE_UINT32);
+
+        // The bindless textures are bound once for all draws.
+        if (_push_descriptors) {
+            // The descriptors are recorded along with the commands, with no
+            // set to allocate or update beforehand.
+            VkDescriptorBufferInfo buffer_info {};
+            VkDescriptorImageInfo image_info {};
+            cmdbuf.push_descriptor_set(VK_PIPELINE_BIND_POINT_GRAPHICS, *_pipeline_layout, 0,
+                                       scene_descriptor_writes(image_index, VK_NULL_HANDLE, buffer_info, image_info));
+            if (_bindless) {
+                std::vector<VkDescriptorSet> descriptor_sets { _bindless_descriptor_set->get_native() };
+                cmdbuf.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, *_pipeline_layout, 1, descriptor_sets);
+            }
+        } else {
+            std::vector<VkDescriptorSet> descriptor_sets { _scene_descriptor_set };
+            if (_bindless) descriptor_sets.push_back(_bindless_descriptor_set->get_native());
+            cmdbuf.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_GRAPHICS, *_pipeline_layout, 0, descriptor_sets);
+        }
 
-            VkDescriptorSet descriptor_set = _descriptor_sets[i].get_native();
-            vkCmdBindDescriptorSets(cmdbuf.get_native(),
-                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                    _pipeline_layout->get_native(),
-                                    0,
-                                    1, &descriptor_set,
-                                    0, 0);
+        if (DEPTH_PREPASS) {
+            cmdbuf.bind_pipeline(*_depth_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS);
+            record_draws(cmdbuf, image_index);
+            if (!_dynamic_rendering) cmdbuf.next_subpass();
+        }
+        cmdbuf.bind_pipeline(*_pipeline, VK_PIPELINE_BIND_POINT_GRAPHICS);
+        record_draws(cmdbuf, image_index);
+    end_scene_rendering(cmdbuf);
+}
+
+void vktest::Application::record_draws (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    if (_gpu_culling) {
+        record_indirect_draws(cmdbuf, image_index);
+        return;
+    }
+    for (const VkDrawIndexedIndirectCommand &draw : _draws) {
+        cmdbuf.draw_indexed(draw.indexCount, draw.instanceCount, draw.firstIndex, draw.vertexOffset, draw.firstInstance);
+    }
+}
+
+void vktest::Application::record_depth_pyramid_commands (const CommandBuffer &cmdbuf) const {
+    // The render graph discarded the old contents of the pyramid and made
+    // the depth attachment of the previous frame the source of the first
+    // level. Without a previous frame, the pyramid only needs a valid layout
+    // for the culling shader, which skips the occlusion test.
+    if (!_depth_history) return;
 
-            cmdbuf.draw_indexed(static_cast<uint32_t>(indices.size()), 1, 0, 0, 0);
-        cmdbuf.end_render_pass();
-        cmdbuf.end();
+    const VkExtent2D &extent = _swap_chain->get_extent();
+    for (uint32_t i = 0; i < _depth_pyramid_levels; i++) {
+        if (i > 0) {
+            // This level reads the previous one.
+            cmdbuf.transition_image(*_depth_pyramid, VK_IMAGE_LAYOUT_GENERAL,
+                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT,
+                                    false, VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, i - 1, 1, 0, 1 });
+            cmdbuf.flush_barriers();
+        }
+        // A multisampled attachment needs its own shader for the first level.
+        bool resolve = i == 0 && _msaa_samples != VK_SAMPLE_COUNT_1_BIT;
+        cmdbuf.bind_pipeline(resolve ? *_depth_resolve_pipeline : *_depth_reduce_pipeline);
+        std::vector<VkDescriptorSet> descriptor_sets { _depth_pyramid_descriptor_sets[i].get_native() };
+        cmdbuf.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, *_depth_pyramid_pipeline_layout, 0, descriptor_sets);
+        uint32_t width = std::max(extent.width >> i, 1u);
+        uint32_t height = std::max(extent.height >> i, 1u);
+        // Work groups of 8x8, see data/depth_reduce.comp.
+        cmdbuf.dispatch((width + 7) / 8, (height + 7) / 8, 1);
     }
 }
 
+void vktest::Application::record_cull_commands (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    // The shader appends to the draw count, which starts from zero.
+    cmdbuf.fill_buffer(*_draw_count_buffers[image_index], 0, sizeof(uint32_t), 0);
+    cmdbuf.add_buffer_barrier(*_draw_count_buffers[image_index], 0, sizeof(uint32_t),
+                              VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    cmdbuf.flush_barriers();
+
+    cmdbuf.bind_pipeline(*_cull_pipeline);
+    std::vector<VkDescriptorSet> descriptor_sets { _cull_descriptor_sets[image_index].get_native() };
+    cmdbuf.bind_descriptor_sets(VK_PIPELINE_BIND_POINT_COMPUTE, *_cull_pipeline_layout, 0, descriptor_sets);
+    // One invocation per object, in work groups of 64 (see data/cull.comp).
+    uint32_t group_count = (static_cast<uint32_t>(_instances.size()) + 63) / 64;
+    cmdbuf.dispatch(group_count, 1, 1);
+
+    // The draw commands and the count are read by the indirect draw.
+    cmdbuf.add_buffer_barrier(*_draw_command_buffers[image_index], 0, VK_WHOLE_SIZE,
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    cmdbuf.add_buffer_barrier(*_draw_count_buffers[image_index], 0, sizeof(uint32_t),
+                              VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                              VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT);
+    cmdbuf.flush_barriers();
+}
+
+void vktest::Application::record_indirect_draws (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    uint32_t max_draw_count = static_cast<uint32_t>(_instances.size());
+    uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (_device->get_features().draw_indirect_count) {
+        // Only the visible objects, as many as the shader counted.
+        cmdbuf.draw_indexed_indirect_count(*_draw_command_buffers[image_index], 0,
+                                           *_draw_count_buffers[image_index], 0,
+                                           max_draw_count, stride);
+    } else {
+        // One command per object, the culled ones draw zero instances.
+        cmdbuf.draw_indexed_indirect(*_draw_command_buffers[image_index], 0, max_draw_count, stride);
+    }
+}
+
+void vktest::Application::begin_scene_rendering (const CommandBuffer &cmdbuf, const VkRect2D &render_area) const {
+    // The render graph has already moved the attachments to their layouts.
+    if (!_dynamic_rendering) {
+        cmdbuf.begin_render_pass(*_render_pass, *_framebuffer, render_area);
+        return;
+    }
+
+    const ImageView &color_view = _color_image_view ? *_color_image_view : *_scene_image_view;
+    // The multisampled color image is resolved into the scene image at the
+    // end, like the resolve attachment of the render pass.
+    std::vector<VkRenderingAttachmentInfo> color_attachments (1);
+    VkRenderingAttachmentInfo &color_attachment = color_attachments[0];
+    color_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    color_attachment.imageView = color_view.get_native();
+    color_attachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    if (_color_image) {
+        color_attachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+        color_attachment.resolveImageView = _scene_image_view->get_native();
+        color_attachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+    color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // Only the resolved samples are needed afterwards.
+    color_attachment.storeOp = _color_image ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE;
+    color_attachment.clearValue.color = {0.0f, 0.0f, 0.0f, 1.0f};
+
+    VkRenderingAttachmentInfo depth_attachment {};
+    depth_attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depth_attachment.imageView = _depth_image_view->get_native();
+    depth_attachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    // The depth pyramid of the next frame is built from it, otherwise it is
+    // not needed afterwards.
+    depth_attachment.storeOp = _gpu_culling ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depth_attachment.clearValue.depthStencil = {1.0f, 0};
+    cmdbuf.begin_rendering(render_area, color_attachments, &depth_attachment);
+}
+
+void vktest::Application::end_scene_rendering (const CommandBuffer &cmdbuf) const {
+    if (_dynamic_rendering) {
+        // The scene image stays a color attachment, *record_present_blit*
+        // transitions it.
+        cmdbuf.end_rendering();
+        return;
+    }
+    cmdbuf.end_render_pass();
+    // The render pass moved the scene image to its final layout on its own,
+    // and its external dependency made it visible to the blit.
+    _scene_image->get_state().assume(VkImageSubresourceRange { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 },
+                                     ImageAccess { VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                                   VK_PIPELINE_STAGE_TRANSFER_BIT,
+                                                   VK_ACCESS_TRANSFER_READ_BIT });
+}
+
+void vktest::Application::record_present_blit (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    VkImage swap_chain_image = _swap_chain->get_images()[image_index];
+    VkImageMemoryBarrier2 barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = swap_chain_image;
+    barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+    // The whole image is overwritten, so its old contents are discarded. The
+    // transfer stage is where the submission waits for the image to be
+    // acquired. The swap chain images are not tracked.
+    barrier.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    barrier.srcAccessMask = 0;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    cmdbuf.add_image_barrier(barrier);
+    // A no-op after the render pass, which already left the scene image ready.
+    cmdbuf.transition_image(*_scene_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+    cmdbuf.flush_barriers();
+
+    // Scales the render extent of the scene image up to the whole swap chain
+    // image.
+    const VkExtent2D &extent = _swap_chain->get_extent();
+    std::vector<VkImageBlit> blits (1);
+    VkImageBlit &blit = blits[0];
+    blit.srcOffsets[0] = { 0, 0, 0 };
+    blit.srcOffsets[1] = { static_cast<int32_t>(_render_extent.width), static_cast<int32_t>(_render_extent.height), 1 };
+    blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    blit.dstOffsets[0] = { 0, 0, 0 };
+    blit.dstOffsets[1] = { static_cast<int32_t>(extent.width), static_cast<int32_t>(extent.height), 1 };
+    blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+    cmdbuf.blit_image(_scene_image->get_native(), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                      swap_chain_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                      blits, _scene_blit_filter);
+
+    // Presentation does not need a stage or an access, the semaphore makes
+    // the write visible.
+    barrier.srcStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstStageMask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+    barrier.dstAccessMask = 0;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    cmdbuf.add_image_barrier(barrier);
+    cmdbuf.flush_barriers();
+}
+
+void vktest::Application::create_query_pool () {
+    _timestamps_written.assign(_swap_chain->get_images().size(), false);
+    _deletion_queue.retire(_frame_number, std::move(_timestamp_query_pool));
+    if (!DYNAMIC_RESOLUTION || !_physical_device->get_properties().limits.timestampComputeAndGraphics) return;
+    uint32_t query_count = static_cast<uint32_t>(_swap_chain->get_images().size()) * 2;
+    _timestamp_query_pool = std::make_unique<QueryPool>(*_device, VK_QUERY_TYPE_TIMESTAMP, query_count);
+}
+
 void vktest::Application::create_sync_objects () {
     _image_available_semaphores.reserve(MAX_FRAMES_IN_FLIGHT);
     _render_finished_semaphores.reserve(MAX_FRAMES_IN_FLIGHT);
     _in_flight_fences.reserve(MAX_FRAMES_IN_FLIGHT);
+    _in_flight_frame_numbers.assign(MAX_FRAMES_IN_FLIGHT, 0);
     _images_in_flight.resize(_swap_chain->get_images().size(), nullptr);
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
         _image_available_semaphores.emplace_back(*_device);
@@ -842,6 +2218,14 @@ void vktest::Application::create_sync_objects () {
 
 void vktest::Application::draw () {
     _in_flight_fences[_current_frame].wait(UINT64_MAX);
+    // Frames complete in the order they were submitted, so the objects
+    // retired up to this one are no longer used.
+    _deletion_queue.collect(_in_flight_frame_numbers[_current_frame]);
+    // Cached objects nothing refers to anymore, retired ones included, can
+    // go as well.
+    _object_cache->trim();
+    // So are the descriptor sets allocated for the frame.
+    if (!_push_descriptors) _descriptor_allocators[_current_frame].reset();
 
     std::optional<uint32_t> image_index = acquire_image();
     if (!image_index) {
@@ -853,8 +2237,28 @@ void vktest::Application::draw () {
     }
     _images_in_flight[*image_index] = &_in_flight_fences[_current_frame];
     _in_flight_fences[_current_frame].reset();
-
-    update_uniform_buffer(*image_index);
+    // The previous command buffer of the image has completed, so its
+    // timestamps can be read.
+    update_render_extent(*image_index);
+
+    UniformBufferObject ubo = update_uniform_buffer(*image_index);
+    // The level of detail and the visible meshlets depend on the current
+    // transforms, so the command buffer of the image is recorded again every
+    // frame. On the GPU-driven path only the culling parameters change.
+    if (_gpu_culling) {
+        update_cull_uniforms(*image_index, ubo);
+    } else {
+        _draws = prepare_draws(*image_index, ubo);
+    }
+    update_scene_descriptor_set(*image_index);
+    record_command_buffer(*image_index);
+    // From now on the depth attachment holds a frame for the next one to cull
+    // against.
+    _depth_history = true;
+    _depth_history_extent = _render_extent;
+    if (_timestamp_query_pool) _timestamps_written[*image_index] = true;
+    _frame_number++;
+    _in_flight_frame_numbers[_current_frame] = _frame_number;
     submit_command_buffer(*image_index);
     present(*image_index);
     _current_frame = (_current_frame + 1) % MAX_FRAMES_IN_FLIGHT;
@@ -864,7 +2268,38 @@ std::optional<uint32_t> vktest::Application::acquire_image () const {
     return _swap_chain->acquire_next_image(UINT64_MAX, &_image_available_semaphores[_current_frame], nullptr);
 }
 
-void vktest::Application::update_uniform_buffer (uint32_t image_index) const {
+std::optional<double> vktest::Application::measure_frame_time (uint32_t image_index) {
+    auto now = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double,std::milli> frame_interval = now - _last_frame_start;
+    bool first_frame = _last_frame_start == std::chrono::high_resolution_clock::time_point {};
+    _last_frame_start = now;
+
+    if (!_timestamp_query_pool) {
+        // The time between frames includes waiting for the presentation
+        // engine, so it can only drive the scale down to the refresh rate.
+        if (first_frame) return std::nullopt;
+        return frame_interval.count();
+    }
+    if (!_timestamps_written[image_index]) return std::nullopt;
+    std::vector<uint64_t> timestamps = _timestamp_query_pool->get_results(image_index * 2, 2);
+    if (timestamps.empty()) return std::nullopt;
+    // timestampPeriod is the number of nanoseconds per tick.
+    double period = _physical_device->get_properties().limits.timestampPeriod;
+    return (timestamps[1] - timestamps[0]) * period / 1.0e6;
+}
+
+void vktest::Application::update_render_extent (uint32_t image_index) {
+    const VkExtent2D &extent = _swap_chain->get_extent();
+    float scale = MAX_RENDER_SCALE;
+    if (DYNAMIC_RESOLUTION) {
+        std::optional<double> frame_time = measure_frame_time(image_index);
+        scale = frame_time ? _resolution_controller.update(*frame_time) : _resolution_controller.get_scale();
+    }
+    _render_extent.width = std::clamp(static_cast<uint32_t>(extent.width * scale), 1u, extent.width);
+    _render_extent.height = std::clamp(static_cast<uint32_t>(extent.height * scale), 1u, extent.height);
+}
+
+vktest::UniformBufferObject vktest::Application::update_uniform_buffer (uint32_t image_index) const {
     static auto start_time = std::chrono::high_resolution_clock::now();
     auto current_time = std::chrono::high_resolution_clock::now();
     float time = std::chrono::duration<float,std::chrono::seconds::period>(current_time - start_time).count();
@@ -887,6 +2322,35 @@ void vktest::Application::update_uniform_buffer (uint32_t image_index) const {
     void *data = _uniform_buffer_memories[idx]->map(0, sizeof(ubo));
     std::memcpy(data, &ubo, sizeof(ubo));
     _uniform_buffer_memories[idx]->unmap();
+    return ubo;
+}
+
+void vktest::Application::update_cull_uniforms (uint32_t image_index, const UniformBufferObject &ubo) const {
+    CullUniforms uniforms {};
+    uniforms.view = ubo.view;
+    uniforms.model = ubo.model;
+    Frustum frustum = extract_frustum(ubo.proj * ubo.view);
+    std::copy(frustum.planes.begin(), frustum.planes.end(), uniforms.frustum);
+    // See *select_lod*.
+    uniforms.pixel_scale = std::abs(ubo.proj[1][1]) * 0.5f * _render_extent.height;
+    uniforms.pixel_error = LOD_PIXEL_ERROR;
+    uniforms.object_count = static_cast<uint32_t>(_instances.size());
+    uniforms.lod_count = static_cast<uint32_t>(_lods.size());
+    uniforms.compact = _device->get_features().draw_indirect_count ? 1 : 0;
+    // The depth of the previous frame is tested with the current transforms,
+    // which is close enough for a camera and objects that move smoothly.
+    uniforms.proj = ubo.proj;
+    uniforms.occlusion = _depth_history ? 1 : 0;
+    const VkExtent2D &extent = _swap_chain->get_extent();
+    uniforms.pyramid_size = glm::vec2(extent.width, extent.height);
+    // Only the part rendered by the previous frame holds its depth.
+    uniforms.pyramid_uv_scale = glm::vec2(_depth_history_extent.width / (float) extent.width,
+                                          _depth_history_extent.height / (float) extent.height);
+
+    size_t idx = static_cast<size_t>(image_index);
+    void *data = _cull_uniform_buffer_memories[idx]->map(0, sizeof(uniforms));
+    std::memcpy(data, &uniforms, sizeof(uniforms));
+    _cull_uniform_buffer_memories[idx]->unmap();
 }
 
 void vktest::Application::submit_command_buffer (uint32_t image_index) const {
@@ -894,8 +2358,9 @@ void vktest::Application::submit_command_buffer (uint32_t image_index) const {
     submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
     VkSemaphore wait_semaphores[] = { _image_available_semaphores[_current_frame].get_native() };
-    // We want to wait with writing colors to the image until it's available.
-    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    // We want to wait with writing to the image until it's available. The
+    // swap chain image is first written by the blit at the end.
+    VkPipelineStageFlags wait_stages[] = { VK_PIPELINE_STAGE_TRANSFER_BIT };
     submit_info.waitSemaphoreCount = 1;
     // Semaphores to wait on before execution begins.
     submit_info.pWaitSemaphores = wait_semaphores;
@@ -942,33 +2407,46 @@ void vktest::Application::present (uint32_t image_index) {
 // the window size.
 void vktest::Application::recreate_swap_chain () {
     handle_minimization();
-    _device->wait_idle();
+    VkFormat old_format = _swap_chain->get_image_format();
     cleanup_swap_chain();
     create_swap_chain();
-    create_render_pass();
-    // NOTE: It is possible to avoid pipeline recreation by using dynamic state
-    // for the viewports and scissor rectangles.
-    create_pipeline();
-    create_color_resources();
-    create_depth_resources();
+    // No frame has used the new images yet.
+    _images_in_flight.assign(_swap_chain->get_images().size(), nullptr);
+    // The viewport and scissor are dynamic state, so the render pass and the
+    // pipelines only depend on the formats, which rarely change.
+    if (_swap_chain->get_image_format() != old_format) recreate_pipelines();
+    create_render_graph();
     create_framebuffers();
     create_uniform_buffers();
+    create_visible_index_buffers();
+    create_instance_buffers();
+    create_cull_buffers();
     create_descriptor_pool();
-    create_descriptor_sets();
+    create_cull_descriptor_sets();
+    create_depth_pyramid_descriptor_sets();
     create_command_buffers();
-    record_command_buffers();
+    create_query_pool();
 }
 
+// The objects that depend on the swap chain are destroyed once the frames
+// that use them have completed, so there is no need to wait for the device.
+// The swap chain itself is replaced in *create_swap_chain*.
 void vktest::Application::cleanup_swap_chain () {
-    _pipeline.reset();
-    _pipeline_layout.reset();
-    _render_pass.reset();
-    _command_pool->free_buffers( _swap_chain->get_command_buffers() );
-    _swap_chain.reset();
-    _uniform_buffers.clear();
-    _uniform_buffer_memories.clear();
-    _descriptor_sets.clear();
-    _descriptor_pool.reset();
+    _deletion_queue.retire(_frame_number, std::move(_uniform_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_uniform_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_visible_index_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_visible_index_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_instance_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_instance_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_cull_uniform_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_cull_uniform_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_draw_command_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_draw_command_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_draw_count_buffers));
+    _deletion_queue.retire(_frame_number, std::move(_draw_count_buffer_memories));
+    _deletion_queue.retire(_frame_number, std::move(_cull_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_depth_pyramid_descriptor_sets));
+    _deletion_queue.retire(_frame_number, std::move(_descriptor_pool));
 }
 
 void vktest::Application::handle_minimization () const noexcept {
@@ -20,10 +20,12 @@
 #include "Queue.hpp"
 #include "Surface.hpp"
 #include "SwapChain.hpp"
+#include "Framebuffer.hpp"
 #include "Shader.hpp"
 #include "RenderPass.hpp"
 #include "PipelineLayout.hpp"
 #include "Pipeline.hpp"
+#include "ComputePipeline.hpp"
 #include "CommandPool.hpp"
 #include "Semaphore.hpp"
 #include "Fence.hpp"
@@ -32,23 +34,74 @@
 #include "DescriptorSetLayout.hpp"
 #include "DescriptorPool.hpp"
 #include "DescriptorSet.hpp"
+#include "DescriptorAllocator.hpp"
 #include "Image.hpp"
 #include "ImageView.hpp"
 #include "Sampler.hpp"
+#include "QueryPool.hpp"
+#include "ResolutionController.hpp"
+#include "RenderGraph.hpp"
+#include "DeletionQueue.hpp"
+#include "ObjectCache.hpp"
+#include "AssetLoader.hpp"
 #include "Vertex.hpp"
+#include "Mesh.hpp"
+#include "InstanceData.hpp"
+#include "UniformBufferObject.hpp"
+#include "CullUniforms.hpp"
 
 namespace vktest {
+    /**
+     * How the mip levels of a texture stored without them are generated.
+     */
+    enum class MipGenerator {
+        // vkCmdBlitImage from every level to the next.
+        blit,
+        // data/mip_generate.comp, all levels in one dispatch.
+        compute,
+        // MipGeneration.hpp, before the levels are uploaded.
+        cpu
+    };
+
+    /**
+     * What a mip generator needs besides the texture image. It is created
+     * before the levels are generated, so that the speed test times the
+     * generation alone. Blitting needs nothing.
+     */
+    struct MipGenerationResources {
+        // MipGenerator::compute: an RGBA8 UNORM copy of the image with a view
+        // per level, the state of data/mip_generate.comp and the set that
+        // binds them.
+        std::unique_ptr<DeviceMemory> levels_image_memory;
+        std::unique_ptr<Image> levels_image;
+        std::vector<ImageView> level_views;
+        std::unique_ptr<DeviceMemory> state_buffer_memory;
+        std::unique_ptr<Buffer> state_buffer;
+        std::unique_ptr<DescriptorPool> descriptor_pool;
+        std::vector<DescriptorSet> descriptor_sets;
+        // MipGenerator::cpu: levels 1 and on, one after the other, and where
+        // they are copied to.
+        std::unique_ptr<StagingBuffer> staging;
+        std::vector<VkBufferImageCopy> regions;
+    };
+
     class Application {
     public:
         Application (std::string app_name);
 
     private:
         void init ();
+        void start_asset_loading ();
+        std::unique_ptr<Shader> create_shader (const std::string &path, VkShaderStageFlagBits stage);
         void loop ();
         void update ();
+        void swap_in_loaded_assets ();
+        void recreate_scene_buffers ();
 
         void init_window ();
         static void on_framebuffer_resize (GLFWwindow *window, int width, int height);
+        static void on_key (GLFWwindow *window, int key, int scancode, int action, int mods);
+        void apply_quality_profile (size_t index);
 
         void init_vulkan ();
         void create_swap_chain ();
@@ -56,6 +109,20 @@ namespace vktest {
         std::vector<VkSubpassDependency> prepare_subpass_dependencies () const noexcept;
         void create_descriptor_set_layout ();
         void create_pipeline ();
+        std::unique_ptr<Pipeline> create_graphics_pipeline (
+                const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+                const PipelineOptions &options) const;
+        void recreate_pipelines ();
+        void create_cull_pipeline ();
+        void create_mip_generation_pipeline ();
+        void create_render_graph ();
+        VkImageCreateInfo prepare_attachment_info (VkFormat format,
+                                                   VkSampleCountFlagBits num_samples,
+                                                   VkImageUsageFlags usage) const noexcept;
+        void report_attachment_memory () const;
+        void report_object_cache () const;
         void create_framebuffers ();
 
         /*
@@ -65,14 +132,17 @@ namespace vktest {
          * *create_texture_image*.
         */
 
-        void create_color_resources ();
-        void create_depth_resources ();
+        void create_depth_pyramid ();
         VkFormat find_depth_format () const;
-        bool has_stencil_component (VkFormat format) const noexcept;
         VkFormat find_supported_format (const std::vector<VkFormat>& candidates,
                                         VkImageTiling tiling,
                                         VkFormatFeatureFlags features) const;
-        void create_texture_image ();
+        /**
+         * Copies the stored mip levels in one go and generates the others if
+         * there is only the base level.
+         */
+        void create_texture_image (const TextureData &texture);
+        bool can_sample_texture_format (VkFormat format) const;
         std::pair<std::unique_ptr<Image>,std::unique_ptr<DeviceMemory>> create_image (
                 uint32_t width,
                 uint32_t height,
@@ -82,32 +152,91 @@ namespace vktest {
                 VkImageTiling tiling,
                 VkImageUsageFlags usage,
                 VkMemoryPropertyFlags properties) const;
+        /**
+         * The generators that can generate *mip_levels* levels of *format*,
+         * in the order of MipGenerator.
+         */
+        std::vector<MipGenerator> get_mip_generators (VkFormat format, uint32_t mip_levels) const;
+        /**
+         * Generates the levels of the texture image with each of
+         * *generators* in turn and returns the fastest. Each one runs once
+         * untimed first, and its resources are created beforehand.
+         */
+        MipGenerator time_mip_generators (const TextureData &texture, const std::vector<MipGenerator> &generators);
+        MipGenerationResources prepare_mip_generation (MipGenerator generator,
+                                                       VkFormat image_format,
+                                                       uint32_t width,
+                                                       uint32_t height,
+                                                       uint32_t mip_levels) const;
+        /**
+         * Generates the levels of the texture image from its base level, and
+         * transitions it to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL.
+         *
+         * @param resources From *prepare_mip_generation* for *generator*.
+         */
+        void generate_texture_mipmaps (MipGenerator generator,
+                                       const TextureData &texture,
+                                       const MipGenerationResources &resources);
         void generate_mipmaps (const Image &image,
                                VkFormat image_format,
                                int32_t width,
                                int32_t height,
                                uint32_t mip_levels) const;
+        void generate_mipmaps_with_compute (const Image &image,
+                                            VkFormat image_format,
+                                            uint32_t width,
+                                            uint32_t height,
+                                            uint32_t mip_levels,
+                                            const MipGenerationResources &resources) const;
+        void generate_mipmaps_on_cpu (const Image &image,
+                                      const TextureData &texture,
+                                      const MipGenerationResources &resources) const;
         void transition_image_layout (
                 const Image &image,
-                VkFormat format,
-                VkImageLayout old_layout,
                 VkImageLayout new_layout,
-                uint32_t mip_levels) const;
+                VkPipelineStageFlags stages,
+                VkAccessFlags access) const;
         void copy_buffer_to_image (
                 const Buffer &buffer,
                 const Image &image,
-                uint32_t width,
-                uint32_t height) const;
-        VkSampleCountFlagBits get_max_usable_sample_count () const noexcept;
+                const std::vector<VkBufferImageCopy> &regions) const;
+        VkSampleCountFlagBits get_usable_sample_count (VkSampleCountFlagBits max_samples) const noexcept;
         void create_texture_image_view ();
         void create_texture_sampler ();
+        void create_bindless_descriptor_set ();
+        /**
+         * Writes the view into the next free slot of the bindless texture
+         * array, which may happen while frames that use other slots are in
+         * flight.
+         *
+         * @return The index of the slot, the material of the instances that
+         * use the texture.
+         */
+        uint32_t add_bindless_texture (const ImageView &view);
 
-        void load_model ();
+        void load_model (ModelData model);
+        std::vector<glm::vec3> get_positions () const;
+        void build_lods ();
+        void build_meshlets ();
+        void create_instances ();
+        bool can_cull_on_gpu () const noexcept;
+        size_t select_lod (const glm::mat4 &model_view, const glm::mat4 &proj) const noexcept;
+        uint32_t cull_meshlets (uint32_t image_index,
+                                const MeshLod &lod,
+                                const glm::mat4 &model_view,
+                                const glm::mat4 &proj) const;
+        std::vector<VkDrawIndexedIndirectCommand> prepare_draws (uint32_t image_index, const UniformBufferObject &ubo) const;
         void create_vertex_buffer ();
         void create_index_buffer ();
         void create_uniform_buffers ();
+        void create_visible_index_buffers ();
+        void create_instance_buffers ();
+        void create_scene_buffers ();
+        void create_cull_buffers ();
         std::pair<std::unique_ptr<Buffer>,std::unique_ptr<DeviceMemory>> create_buffer (
                 VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties) const;
+        std::pair<std::unique_ptr<Buffer>,std::unique_ptr<DeviceMemory>> create_device_local_buffer (
+                const void *src_data, VkDeviceSize size, VkBufferUsageFlags usage) const;
         uint32_t find_memory_type (uint32_t type_filter, VkMemoryPropertyFlags properties) const;
         void copy_buffer (const Buffer &src, const Buffer &dest, VkDeviceSize size) const;
 
@@ -115,15 +244,34 @@ namespace vktest {
         void end_single_time_commands (CommandBuffer cmdbuf) const;
 
         void create_descriptor_pool ();
-        void create_descriptor_sets ();
+        void create_descriptor_allocators ();
+        std::vector<VkWriteDescriptorSet> scene_descriptor_writes (uint32_t image_index,
+                                                                   VkDescriptorSet set,
+                                                                   VkDescriptorBufferInfo &buffer_info,
+                                                                   VkDescriptorImageInfo &image_info) const;
+        void update_scene_descriptor_set (uint32_t image_index);
+        void create_cull_descriptor_sets ();
+        void create_depth_pyramid_descriptor_sets ();
 
         void create_command_buffers ();
-        void record_command_buffers () const;
+        void create_query_pool ();
+        void record_command_buffer (uint32_t image_index) const;
+        void record_scene_pass (const CommandBuffer &cmdbuf, uint32_t image_index) const;
+        void record_draws (const CommandBuffer &cmdbuf, uint32_t image_index) const;
+        void record_depth_pyramid_commands (const CommandBuffer &cmdbuf) const;
+        void record_cull_commands (const CommandBuffer &cmdbuf, uint32_t image_index) const;
+        void record_indirect_draws (const CommandBuffer &cmdbuf, uint32_t image_index) const;
+        void begin_scene_rendering (const CommandBuffer &cmdbuf, const VkRect2D &render_area) const;
+        void end_scene_rendering (const CommandBuffer &cmdbuf) const;
+        void record_present_blit (const CommandBuffer &cmdbuf, uint32_t image_index) const;
         void create_sync_objects ();
 
         void draw ();
         std::optional<uint32_t> acquire_image () const;
-        void update_uniform_buffer (uint32_t image_index) const;
+        std::optional<double> measure_frame_time (uint32_t image_index);
+        void update_render_extent (uint32_t image_index);
+        UniformBufferObject update_uniform_buffer (uint32_t image_index) const;
+        void update_cull_uniforms (uint32_t image_index, const UniformBufferObject &ubo) const;
         void submit_command_buffer (uint32_t image_index) const;
         void present (uint32_t image_index);
 
@@ -138,47 +286,168 @@ namespace vktest {
         std::unique_ptr<Instance> _instance;
         const PhysicalDevice *_physical_device;
         VkSampleCountFlagBits _msaa_samples = VK_SAMPLE_COUNT_1_BIT;
+        // Index into *quality_profiles*; a key press requests a change, which
+        // is applied between frames.
+        size_t _quality_profile;
+        std::optional<size_t> _requested_quality_profile;
         std::unique_ptr<Surface> _surface;
         std::unique_ptr<Device> _device;
+        // Samplers, layouts and render passes, shared by whoever asks for
+        // equal ones.
+        std::unique_ptr<ObjectCache> _object_cache;
+        // Until the assets are loaded. Declared after the device, since the
+        // textures are decoded into staging buffers of it.
+        std::unique_ptr<AssetLoader> _asset_loader;
         const Queue *_graphics_queue;
         const Queue *_present_queue;
         std::unique_ptr<CommandPool> _command_pool;
         std::unique_ptr<SwapChain> _swap_chain;
 
         std::unique_ptr<Shader> _vert_shader;
+        std::unique_ptr<Shader> _depth_vert_shader;
         std::unique_ptr<Shader> _frag_shader;
+        std::unique_ptr<Shader> _cull_shader;
+        std::unique_ptr<Shader> _depth_resolve_shader;
+        std::unique_ptr<Shader> _depth_reduce_shader;
+        std::unique_ptr<Shader> _mip_generation_shader;
 
-        std::unique_ptr<RenderPass> _render_pass;
-        std::unique_ptr<DescriptorSetLayout> _descriptor_set_layout;
-        std::unique_ptr<PipelineLayout> _pipeline_layout;
+        // With dynamic rendering there is neither a render pass nor a
+        // framebuffer, and the pipelines only depend on the formats.
+        bool _dynamic_rendering;
+        std::shared_ptr<RenderPass> _render_pass;
+        std::shared_ptr<DescriptorSetLayout> _descriptor_set_layout;
+        std::shared_ptr<PipelineLayout> _pipeline_layout;
         std::unique_ptr<Pipeline> _pipeline;
+        // Depth-only pipeline of the pre-pass, if enabled.
+        std::unique_ptr<Pipeline> _depth_pipeline;
+        std::shared_ptr<DescriptorSetLayout> _cull_descriptor_set_layout;
+        std::shared_ptr<PipelineLayout> _cull_pipeline_layout;
+        std::unique_ptr<ComputePipeline> _cull_pipeline;
+        std::shared_ptr<DescriptorSetLayout> _depth_pyramid_descriptor_set_layout;
+        std::shared_ptr<PipelineLayout> _depth_pyramid_pipeline_layout;
+        std::unique_ptr<ComputePipeline> _depth_resolve_pipeline;
+        std::unique_ptr<ComputePipeline> _depth_reduce_pipeline;
+        // Only where the compute generator is supported.
+        std::shared_ptr<DescriptorSetLayout> _mip_generation_descriptor_set_layout;
+        std::shared_ptr<PipelineLayout> _mip_generation_pipeline_layout;
+        std::unique_ptr<ComputePipeline> _mip_generation_pipeline;
+
+        // The passes of a frame and the attachments they use. The graph owns
+        // the scene, color and depth images.
+        std::unique_ptr<RenderGraph> _render_graph;
+        // The single-sampled image the scene is rendered (or resolved) to at
+        // *_render_extent*, and blitted from into the swap chain image.
+        const Image *_scene_image;
+        std::unique_ptr<ImageView> _scene_image_view;
+        VkFilter _scene_blit_filter;
+        std::unique_ptr<Framebuffer> _framebuffer;
 
-        std::unique_ptr<DeviceMemory> _color_image_memory;
-        std::unique_ptr<Image> _color_image;
+        // The part of the attachments that is rendered to, chosen by
+        // *_resolution_controller* from the time of the previous frames.
+        VkExtent2D _render_extent;
+        // The render extent of the frame the depth attachment holds.
+        VkExtent2D _depth_history_extent;
+        ResolutionController _resolution_controller;
+        // Two timestamps per swap chain image, around its command buffer.
+        // Without timestamp support the time between frames is used.
+        std::unique_ptr<QueryPool> _timestamp_query_pool;
+        std::vector<bool> _timestamps_written;
+        std::chrono::high_resolution_clock::time_point _last_frame_start;
+
+        // Multisampled color attachment, null without multisampling.
+        const Image *_color_image;
         std::unique_ptr<ImageView> _color_image_view;
 
-        std::unique_ptr<DeviceMemory> _dpeth_image_memory;
-        std::unique_ptr<Image> _depth_image;
+        const Image *_depth_image;
         std::unique_ptr<ImageView> _depth_image_view;
 
+        // Hierarchical depth of the previous frame for occlusion culling:
+        // each level keeps the farthest depth of the level below.
+        uint32_t _depth_pyramid_levels;
+        std::unique_ptr<DeviceMemory> _depth_pyramid_memory;
+        std::unique_ptr<Image> _depth_pyramid;
+        std::unique_ptr<ImageView> _depth_pyramid_view;
+        std::vector<ImageView> _depth_pyramid_level_views;
+        std::shared_ptr<Sampler> _depth_pyramid_sampler;
+        // Whether the depth attachment holds a rendered frame yet.
+        bool _depth_history;
+
         uint32_t _mip_levels;
+        // Picked on the first texture that needs its mip levels generated.
+        std::optional<MipGenerator> _mip_generator;
+        VkFormat _texture_format;
         std::unique_ptr<DeviceMemory> _texture_image_memory;
         std::unique_ptr<Image> _texture_image;
         std::unique_ptr<ImageView> _texture_image_view;
-        std::unique_ptr<Sampler> _texture_sampler;
+        std::shared_ptr<Sampler> _texture_sampler;
+        // With bindless textures, set 1 holds the textures of all materials
+        // and binding 1 of set 0 only the sampler.
+        bool _bindless;
+        std::shared_ptr<DescriptorSetLayout> _bindless_descriptor_set_layout;
+        std::unique_ptr<DescriptorPool> _bindless_descriptor_pool;
+        std::unique_ptr<DescriptorSet> _bindless_descriptor_set;
+        uint32_t _bindless_texture_count;
+        // With progressive startup a placeholder is used until the texture
+        // and the model are loaded, see *swap_in_loaded_assets*.
+        bool _texture_pending;
+        // The bindless slot of the texture, the material of the instances.
+        uint32_t _texture_index;
+        bool _model_pending;
 
         std::vector<Vertex> vertices;
+        // Index ranges of all levels of detail, see *_lods*.
         std::vector<uint32_t> indices;
-        std::unique_ptr<DeviceMemory> _vertex_buffer_memory;
-        std::unique_ptr<Buffer> _vertex_buffer;
+        std::vector<MeshLod> _lods;
+        std::vector<Meshlet> _meshlets;
+        BoundingSphere _bounding_sphere;
+        std::vector<InstanceData> _instances;
+        // The draws of the current frame on the CPU path.
+        std::vector<VkDrawIndexedIndirectCommand> _draws;
+        // Vertex streams: positions and the remaining attributes are kept in
+        // separate buffers, so position-only passes can bind only the first.
+        std::unique_ptr<DeviceMemory> _position_buffer_memory;
+        std::unique_ptr<Buffer> _position_buffer;
+        std::unique_ptr<DeviceMemory> _attribute_buffer_memory;
+        std::unique_ptr<Buffer> _attribute_buffer;
         std::unique_ptr<DeviceMemory> _index_buffer_memory;
         std::unique_ptr<Buffer> _index_buffer;
+        // GPU-driven path: when enabled, the instances are culled and their
+        // draw commands written by a compute shader, so the CPU cost of a
+        // frame does not depend on the number of instances.
+        bool _gpu_culling;
+        std::unique_ptr<DeviceMemory> _object_buffer_memory;
+        std::unique_ptr<Buffer> _object_buffer;
+        std::unique_ptr<DeviceMemory> _lod_buffer_memory;
+        std::unique_ptr<Buffer> _lod_buffer;
 
         // Uniform buffer per swap chaing image
         std::vector<std::unique_ptr<DeviceMemory>> _uniform_buffer_memories;
         std::vector<std::unique_ptr<Buffer>> _uniform_buffers;
+        // Indices of the meshlets that survived culling, per swap chain image.
+        std::vector<std::unique_ptr<DeviceMemory>> _visible_index_buffer_memories;
+        std::vector<std::unique_ptr<Buffer>> _visible_index_buffers;
+        // Transforms of the visible instances, per swap chain image.
+        std::vector<std::unique_ptr<DeviceMemory>> _instance_buffer_memories;
+        std::vector<std::unique_ptr<Buffer>> _instance_buffers;
+        // Culling parameters, the draw commands and their count, per swap
+        // chain image.
+        std::vector<std::unique_ptr<DeviceMemory>> _cull_uniform_buffer_memories;
+        std::vector<std::unique_ptr<Buffer>> _cull_uniform_buffers;
+        std::vector<std::unique_ptr<DeviceMemory>> _draw_command_buffer_memories;
+        std::vector<std::unique_ptr<Buffer>> _draw_command_buffers;
+        std::vector<std::unique_ptr<DeviceMemory>> _draw_count_buffer_memories;
+        std::vector<std::unique_ptr<Buffer>> _draw_count_buffers;
+        // Culling and depth pyramid sets, per swap chain image.
         std::unique_ptr<DescriptorPool> _descriptor_pool;
-        std::vector<DescriptorSet> _descriptor_sets;
+        // Whether the scene set is pushed, with VK_KHR_push_descriptor.
+        bool _push_descriptors;
+        // The scene set of the current frame, from its allocator in
+        // *_descriptor_allocators*, one per frame in flight. With push
+        // descriptors it is written into the command buffer instead.
+        VkDescriptorSet _scene_descriptor_set;
+        std::vector<DescriptorAllocator> _descriptor_allocators;
+        std::vector<DescriptorSet> _cull_descriptor_sets;
+        std::vector<DescriptorSet> _depth_pyramid_descriptor_sets;
 
         // Each frame should have its own set of semaphores.
         std::vector<Semaphore> _image_available_semaphores;
@@ -186,7 +455,14 @@ namespace vktest {
         std::vector<Fence> _in_flight_fences;
         std::vector<const Fence*> _images_in_flight;
         size_t _current_frame;
+        // The number of the last submitted frame, counting from 1, and of the
+        // frame each of *_in_flight_fences* signals.
+        uint64_t _frame_number;
+        std::vector<uint64_t> _in_flight_frame_numbers;
         bool _framebuffer_resized;
+        // Objects replaced while earlier frames may still use them. Declared
+        // last so that they are destroyed before what they were created from.
+        DeletionQueue _deletion_queue;
     };
 }
 
@@ -0,0 +1,203 @@
+#include "AssetLoader.hpp"
+#include "Ktx2.hpp"
+#include "BlockCompression.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+namespace vktest {
+    template <typename T>
+    static std::vector<T> read_file (const std::string &path) {
+        std::ifstream file { path, std::ios::ate | std::ios::binary };
+        if (!file.is_open()) throw std::runtime_error("Failed to open file " + path);
+        size_t file_size = (size_t) file.tellg();
+        std::vector<T> buffer (file_size);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(buffer.data()), file_size);
+        return buffer;
+    }
+
+    static TextureData load_texture (const std::string &path, const Device &device) {
+        std::ifstream file { path, std::ios::binary };
+        if (!file.is_open()) throw std::runtime_error("Failed to open file " + path);
+        TextureData texture {};
+        // KTX2 files are uploaded as they are, with their mip levels. Only
+        // the header is read into host memory; each level is read from the
+        // file straight into the staging buffer, however large it is.
+        if (is_ktx2(file)) {
+            Ktx2Image image = read_ktx2(file);
+            texture.format = image.format;
+            texture.width = image.width;
+            texture.height = image.height;
+            size_t alignment = std::max(get_block_size(image.format), size_t(4));
+            size_t size = 0;
+            for (const Ktx2Level &level : image.levels) {
+                size = (size + alignment - 1) / alignment * alignment;
+                texture.levels.push_back({ size, level.size });
+                size += level.size;
+            }
+            // A base level alone may be read back to generate the mip levels
+            // or to decode its blocks, and BC blocks are read back to decode
+            // them where the device cannot sample them.
+            bool read_back = image.levels.size() == 1 || is_block_compressed(image.format);
+            texture.staging = std::make_unique<StagingBuffer>(device, size, read_back);
+            for (size_t i = 0; i < image.levels.size(); i++) {
+                file.seekg(static_cast<std::streamoff>(image.levels[i].offset));
+                file.read(reinterpret_cast<char*>(texture.staging->get_data() + texture.levels[i].offset),
+                          static_cast<std::streamsize>(image.levels[i].size));
+            }
+            if (!file) throw std::runtime_error("Failed to read texture file " + path);
+            return texture;
+        }
+        file.close();
+
+        // stb_image only decodes into memory it allocates itself, so the
+        // texels are copied into the staging buffer once, with no copy of
+        // the file or of the texels in between.
+        int width, height, channels;
+        std::unique_ptr<stbi_uc, void (*)(void*)> pixels {
+            stbi_load(path.c_str(), &width, &height, &channels, STBI_rgb_alpha), stbi_image_free
+        };
+        if (!pixels) throw std::runtime_error("Failed to load texture image");
+        size_t size = static_cast<size_t>(width) * height * 4;
+        texture.width = static_cast<uint32_t>(width);
+        texture.height = static_cast<uint32_t>(height);
+        texture.levels.push_back({ 0, size });
+        // Read back if the mip levels are generated on the CPU.
+        texture.staging = std::make_unique<StagingBuffer>(device, size, true);
+        std::memcpy(texture.staging->get_data(), pixels.get(), size);
+        return texture;
+    }
+
+    static ModelData load_model (const std::string &path) {
+        /* An OBJ file consists of positions, normals, texture coordinates and
+         * faces. Faces consist of an arbitrary amount of vertices, where each
+         * vertex refers to a position, normal and/or texture coordinate by index.
+         */
+
+        // attrib: Holds all of the positions, normals and texture coordinates in
+        // its attrib.vertices, attrib.normals and attrib.texcoords vectors.
+        tinyobj::attrib_t attrib;
+        // shapes: contains all of the separate objects and their faces.
+        std::vector<tinyobj::shape_t> shapes;
+        // a material and texture per face, but we will be ignoring those.
+        std::vector<tinyobj::material_t> materials;
+        std::string warn, err;
+
+        // Faces in OBJ files can actually contain an arbitrary number of vertices,
+        // whereas our application can only render triangles. Luckily the LoadObj
+        // has an optional parameter to automatically triangulate such faces, which
+        // is enabled by default.
+        bool res = tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, path.c_str());
+        if (!res) throw std::runtime_error(warn + err);
+
+        ModelData model {};
+        // Keep track of the unique vertices and respective indices.
+        std::unordered_map<Vertex, uint32_t> unique_vertices {};
+
+        for (const auto &shape : shapes) {
+            for (const auto &index : shape.mesh.indices) {
+                Vertex vertex {};
+                vertex.color = {1.0f, 1.0f, 1.0f};
+
+                vertex.pos = {
+                    attrib.vertices[3 * index.vertex_index],
+                    attrib.vertices[3 * index.vertex_index + 1],
+                    attrib.vertices[3 * index.vertex_index + 2],
+                };
+
+                // The OBJ format assumes a coordinate system where a vertical
+                // coordinate of 0 means the bottom of the image, however we've
+                // uploaded our image into Vulkan in a top to bottom orientation
+                // where 0 means the top of the image.
+                vertex.tex_coord = {
+                    attrib.texcoords[2 * index.texcoord_index],
+                    1.0f - attrib.texcoords[2 * index.texcoord_index + 1],
+                };
+
+                if (unique_vertices.count(vertex) == 0) {
+                    unique_vertices[vertex] = static_cast<uint32_t>(model.vertices.size());
+                    model.vertices.push_back(vertex);
+                }
+                model.indices.push_back(unique_vertices[vertex]);
+            }
+        }
+        return model;
+    }
+
+    // Starts loading *path* unless it is loading already.
+    template <typename T, typename Load>
+    static void request (std::unordered_map<std::string, std::future<T>> &futures,
+                         const std::string &path,
+                         Load load) {
+        if (futures.count(path) != 0) return;
+        futures.emplace(path, std::async(std::launch::async, load, path));
+    }
+
+    template <typename T>
+    static bool is_loading (const std::unordered_map<std::string, std::future<T>> &futures,
+                            const std::string &path) noexcept {
+        auto it = futures.find(path);
+        if (it == futures.end()) return false;
+        return it->second.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+
+    template <typename T, typename Load>
+    static T take (std::unordered_map<std::string, std::future<T>> &futures,
+                   const std::string &path,
+                   Load load) {
+        auto it = futures.find(path);
+        if (it == futures.end()) return load(path);
+        std::future<T> future = std::move(it->second);
+        futures.erase(it);
+        return future.get();
+    }
+}
+
+vktest::AssetLoader::AssetLoader ()
+        : _files {},
+          _textures {},
+          _models {} {
+}
+
+vktest::AssetLoader::AssetLoader (AssetLoader &&other) noexcept
+        : _files (std::move(other._files)),
+          _textures (std::move(other._textures)),
+          _models (std::move(other._models)) {
+}
+
+void vktest::AssetLoader::request_file (const std::string &path) {
+    request(_files, path, read_file<char>);
+}
+
+void vktest::AssetLoader::request_texture (const std::string &path, const Device &device) {
+    request(_textures, path, [&device] (const std::string &path) { return load_texture(path, device); });
+}
+
+void vktest::AssetLoader::request_model (const std::string &path) {
+    request(_models, path, load_model);
+}
+
+std::vector<char> vktest::AssetLoader::take_file (const std::string &path) {
+    return take(_files, path, read_file<char>);
+}
+
+vktest::TextureData vktest::AssetLoader::take_texture (const std::string &path, const Device &device) {
+    return take(_textures, path, [&device] (const std::string &path) { return load_texture(path, device); });
+}
+
+vktest::ModelData vktest::AssetLoader::take_model (const std::string &path) {
+    return take(_models, path, load_model);
+}
+
+bool vktest::AssetLoader::is_ready (const std::string &path) const noexcept {
+    return !is_loading(_files, path) && !is_loading(_textures, path) && !is_loading(_models, path);
+}
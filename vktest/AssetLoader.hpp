@@ -0,0 +1,77 @@
+#ifndef __VKTEST_ASSETLOADER_HPP__
+#define __VKTEST_ASSETLOADER_HPP__
+
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Vertex.hpp"
+#include "Device.hpp"
+#include "StagingBuffer.hpp"
+
+namespace vktest {
+    struct TextureLevel {
+        // Into the staging buffer of the texture, aligned to the texel block
+        // size and to 4.
+        size_t offset;
+        size_t size;
+    };
+
+    /**
+     * A texture ready to be copied into an image: a decoded PNG or the
+     * levels of a KTX2 file, already in a staging buffer.
+     */
+    struct TextureData {
+        VkFormat format = VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        // The stored mip levels, the base level first. With a single level
+        // the others are generated after uploading.
+        std::vector<TextureLevel> levels {};
+        std::unique_ptr<StagingBuffer> staging {};
+    };
+
+    /**
+     * A triangulated model with its duplicate vertices merged.
+     */
+    struct ModelData {
+        std::vector<Vertex> vertices {};
+        std::vector<uint32_t> indices {};
+    };
+
+    /**
+     * Reads and decodes assets on worker threads, so that the CPU work does
+     * not wait for the device and the pipelines to be created. Assets are
+     * requested as early as possible and taken where they are uploaded; taking
+     * one waits for it and rethrows what its loading threw. Taking an asset
+     * that was not requested loads it right away.
+     *
+     * Textures are written straight into staging buffers of *device*, which
+     * the worker threads create, so the device has to outlive the requests.
+     */
+    class AssetLoader {
+    public:
+        AssetLoader ();
+        AssetLoader (const AssetLoader &) = delete;
+        AssetLoader (AssetLoader &&other) noexcept;
+        void request_file (const std::string &path);
+        void request_texture (const std::string &path, const Device &device);
+        void request_model (const std::string &path);
+        std::vector<char> take_file (const std::string &path);
+        TextureData take_texture (const std::string &path, const Device &device);
+        ModelData take_model (const std::string &path);
+        /**
+         * Whether taking *path* would not wait, either because it has been
+         * loaded or because loading failed.
+         */
+        bool is_ready (const std::string &path) const noexcept;
+
+    private:
+        std::unordered_map<std::string, std::future<std::vector<char>>> _files;
+        std::unordered_map<std::string, std::future<TextureData>> _textures;
+        std::unordered_map<std::string, std::future<ModelData>> _models;
+    };
+}
+
+#endif /* __VKTEST_ASSETLOADER_HPP__ */
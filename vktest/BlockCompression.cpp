@@ -0,0 +1,280 @@
+#include "BlockCompression.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vktest {
+    struct Color {
+        int r, g, b;
+    };
+
+    static uint16_t pack_565 (const Color &c) noexcept {
+        return static_cast<uint16_t>(((c.r * 31 + 127) / 255) << 11
+                                   | ((c.g * 63 + 127) / 255) << 5
+                                   | ((c.b * 31 + 127) / 255));
+    }
+
+    static Color unpack_565 (uint16_t value) noexcept {
+        int r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+        // Replicates the high bits into the low ones, so 31 expands to 255.
+        return { (r << 3) | (r >> 2), (g << 2) | (g >> 4), (b << 3) | (b >> 2) };
+    }
+
+    static int distance (const Color &a, const Color &b) noexcept {
+        int dr = a.r - b.r, dg = a.g - b.g, db = a.b - b.b;
+        return dr * dr + dg * dg + db * db;
+    }
+
+    // The palette of a color block. Without *four_colors* the third color is
+    // the midpoint and the fourth transparent black (BC1 only).
+    static void make_palette (uint16_t c0, uint16_t c1, bool four_colors, Color palette[4]) noexcept {
+        palette[0] = unpack_565(c0);
+        palette[1] = unpack_565(c1);
+        const Color &a = palette[0], &b = palette[1];
+        if (four_colors) {
+            palette[2] = { (2 * a.r + b.r) / 3, (2 * a.g + b.g) / 3, (2 * a.b + b.b) / 3 };
+            palette[3] = { (a.r + 2 * b.r) / 3, (a.g + 2 * b.g) / 3, (a.b + 2 * b.b) / 3 };
+        } else {
+            palette[2] = { (a.r + b.r) / 2, (a.g + b.g) / 2, (a.b + b.b) / 2 };
+            palette[3] = { 0, 0, 0 };
+        }
+    }
+
+    // The 16 texels of the block at (bx, by), edge texels repeated where the
+    // block reaches past the image.
+    static void load_block (const unsigned char *texels, uint32_t width, uint32_t height,
+                            uint32_t bx, uint32_t by, unsigned char block[16][4]) noexcept {
+        for (uint32_t y = 0; y < 4; y++) {
+            for (uint32_t x = 0; x < 4; x++) {
+                uint32_t tx = std::min(bx * 4 + x, width - 1);
+                uint32_t ty = std::min(by * 4 + y, height - 1);
+                std::memcpy(block[y * 4 + x], texels + (static_cast<size_t>(ty) * width + tx) * 4, 4);
+            }
+        }
+    }
+
+    // Always in four-color mode, which BC3 requires and opaque BC1 prefers.
+    static void encode_color_block (const unsigned char block[16][4], unsigned char *out) noexcept {
+        Color min { 255, 255, 255 }, max { 0, 0, 0 };
+        for (int i = 0; i < 16; i++) {
+            min = { std::min(min.r, (int) block[i][0]), std::min(min.g, (int) block[i][1]), std::min(min.b, (int) block[i][2]) };
+            max = { std::max(max.r, (int) block[i][0]), std::max(max.g, (int) block[i][1]), std::max(max.b, (int) block[i][2]) };
+        }
+        // Insetting the box by 1/16 of its size lowers the error of the
+        // texels inside it at the expense of the extremes.
+        Color inset { (max.r - min.r) / 16, (max.g - min.g) / 16, (max.b - min.b) / 16 };
+        max = { max.r - inset.r, max.g - inset.g, max.b - inset.b };
+        min = { min.r + inset.r, min.g + inset.g, min.b + inset.b };
+
+        uint16_t c0 = pack_565(max), c1 = pack_565(min);
+        uint32_t indices = 0;
+        if (c0 < c1) std::swap(c0, c1);
+        if (c0 != c1) {
+            Color palette[4];
+            make_palette(c0, c1, true, palette);
+            for (int i = 0; i < 16; i++) {
+                Color texel { block[i][0], block[i][1], block[i][2] };
+                uint32_t best = 0;
+                for (uint32_t j = 1; j < 4; j++) {
+                    if (distance(texel, palette[j]) < distance(texel, palette[best])) best = j;
+                }
+                indices |= best << (i * 2);
+            }
+        }
+        out[0] = c0 & 0xFF; out[1] = c0 >> 8;
+        out[2] = c1 & 0xFF; out[3] = c1 >> 8;
+        for (int i = 0; i < 4; i++) out[4 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+
+    static void make_alpha_palette (int a0, int a1, int palette[8]) noexcept {
+        palette[0] = a0;
+        palette[1] = a1;
+        if (a0 > a1) {
+            for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+        } else {
+            for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+    }
+
+    static void encode_alpha_block (const unsigned char block[16][4], unsigned char *out) noexcept {
+        int a0 = 0, a1 = 255;
+        for (int i = 0; i < 16; i++) {
+            a0 = std::max(a0, (int) block[i][3]);
+            a1 = std::min(a1, (int) block[i][3]);
+        }
+        uint64_t indices = 0;
+        if (a0 != a1) {
+            // Eight interpolated values, since a0 > a1.
+            int palette[8];
+            make_alpha_palette(a0, a1, palette);
+            for (int i = 0; i < 16; i++) {
+                uint64_t best = 0;
+                for (uint64_t j = 1; j < 8; j++) {
+                    if (std::abs(block[i][3] - palette[j]) < std::abs(block[i][3] - palette[best])) best = j;
+                }
+                indices |= best << (i * 3);
+            }
+        }
+        out[0] = static_cast<unsigned char>(a0);
+        out[1] = static_cast<unsigned char>(a1);
+        for (int i = 0; i < 6; i++) out[2 + i] = (indices >> (i * 8)) & 0xFF;
+    }
+
+    // BC1 blocks may use three colors and black, which is transparent only
+    // in the BC1 formats with alpha.
+    static void decode_color_block (const unsigned char *in, bool bc1, bool bc1_alpha, unsigned char block[16][4]) noexcept {
+        uint16_t c0 = in[0] | in[1] << 8, c1 = in[2] | in[3] << 8;
+        uint32_t indices = in[4] | in[5] << 8 | in[6] << 16 | static_cast<uint32_t>(in[7]) << 24;
+        Color palette[4];
+        bool four_colors = !bc1 || c0 > c1;
+        make_palette(c0, c1, four_colors, palette);
+        for (int i = 0; i < 16; i++) {
+            uint32_t index = (indices >> (i * 2)) & 3;
+            block[i][0] = static_cast<unsigned char>(palette[index].r);
+            block[i][1] = static_cast<unsigned char>(palette[index].g);
+            block[i][2] = static_cast<unsigned char>(palette[index].b);
+            block[i][3] = bc1_alpha && !four_colors && index == 3 ? 0 : 255;
+        }
+    }
+
+    static void decode_alpha_block (const unsigned char *in, unsigned char block[16][4]) noexcept {
+        int palette[8];
+        make_alpha_palette(in[0], in[1], palette);
+        uint64_t indices = 0;
+        for (int i = 0; i < 6; i++) indices |= static_cast<uint64_t>(in[2 + i]) << (i * 8);
+        for (int i = 0; i < 16; i++) {
+            block[i][3] = static_cast<unsigned char>(palette[(indices >> (i * 3)) & 7]);
+        }
+    }
+}
+
+bool vktest::is_block_compressed (VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool vktest::is_block_format (VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            return true;
+        default:
+            return is_block_compressed(format);
+    }
+}
+
+size_t vktest::get_block_size (VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+        case VK_FORMAT_BC7_UNORM_BLOCK:
+        case VK_FORMAT_BC7_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            return 16;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+        case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+            return 8;
+        default:
+            return 4;
+    }
+}
+
+size_t vktest::get_level_size (VkFormat format, uint32_t width, uint32_t height) noexcept {
+    if (!is_block_format(format)) return static_cast<size_t>(width) * height * get_block_size(format);
+    return static_cast<size_t>((width + 3) / 4) * ((height + 3) / 4) * get_block_size(format);
+}
+
+VkFormat vktest::get_decompressed_format (VkFormat format) noexcept {
+    switch (format) {
+        case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+        case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+        case VK_FORMAT_BC3_SRGB_BLOCK:
+            return VK_FORMAT_R8G8B8A8_SRGB;
+        case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+        case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+        case VK_FORMAT_BC3_UNORM_BLOCK:
+            return VK_FORMAT_R8G8B8A8_UNORM;
+        default:
+            return format;
+    }
+}
+
+std::vector<unsigned char> vktest::encode_blocks (VkFormat format,
+                                                  const unsigned char *texels,
+                                                  uint32_t width,
+                                                  uint32_t height) {
+    if (!is_block_compressed(format)) throw std::runtime_error("Failed to encode blocks, the format is not supported");
+    bool bc3 = get_block_size(format) == 16;
+    uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    std::vector<unsigned char> blocks (get_level_size(format, width, height));
+    unsigned char *out = blocks.data();
+    unsigned char block[16][4];
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            load_block(texels, width, height, bx, by, block);
+            // BC3 stores the alpha block before the color block.
+            if (bc3) {
+                encode_alpha_block(block, out);
+                out += 8;
+            }
+            encode_color_block(block, out);
+            out += 8;
+        }
+    }
+    return blocks;
+}
+
+void vktest::decode_blocks (VkFormat format,
+                            const unsigned char *blocks,
+                            uint32_t width,
+                            uint32_t height,
+                            unsigned char *texels) {
+    if (!is_block_compressed(format)) throw std::runtime_error("Failed to decode blocks, the format is not supported");
+    bool bc3 = get_block_size(format) == 16;
+    bool bc1_alpha = format == VK_FORMAT_BC1_RGBA_UNORM_BLOCK || format == VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    uint32_t blocks_x = (width + 3) / 4, blocks_y = (height + 3) / 4;
+    size_t row_size = static_cast<size_t>(width) * 4;
+    // Four texel rows, as wide as the blocks.
+    std::vector<unsigned char> rows (static_cast<size_t>(blocks_x) * 4 * 16);
+    size_t rows_pitch = static_cast<size_t>(blocks_x) * 16;
+    const unsigned char *in = blocks;
+    unsigned char block[16][4];
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            decode_color_block(bc3 ? in + 8 : in, !bc3, bc1_alpha, block);
+            if (bc3) decode_alpha_block(in, block);
+            in += get_block_size(format);
+            for (uint32_t y = 0; y < 4; y++) {
+                std::memcpy(rows.data() + y * rows_pitch + bx * 16, block[y * 4], 16);
+            }
+        }
+        // Only the texels inside the image are written.
+        for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+            std::memcpy(texels + (by * 4 + y) * row_size, rows.data() + y * rows_pitch, row_size);
+        }
+    }
+}
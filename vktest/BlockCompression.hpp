@@ -0,0 +1,56 @@
+#ifndef __VKTEST_BLOCKCOMPRESSION_HPP__
+#define __VKTEST_BLOCKCOMPRESSION_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <vector>
+
+namespace vktest {
+    /**
+     * Whether the format is one of the BC1 and BC3 formats this file encodes
+     * and decodes.
+     */
+    bool is_block_compressed (VkFormat format) noexcept;
+    /**
+     * Whether the format stores 4x4 blocks, including the BC7 and ETC2
+     * formats this file cannot encode or decode.
+     */
+    bool is_block_format (VkFormat format) noexcept;
+    /**
+     * The bytes of a 4x4 block, or of a texel for uncompressed formats.
+     */
+    size_t get_block_size (VkFormat format) noexcept;
+    /**
+     * The bytes of a *width* x *height* level, in whole blocks.
+     */
+    size_t get_level_size (VkFormat format, uint32_t width, uint32_t height) noexcept;
+    /**
+     * The 8-bit RGBA format with the same color space.
+     */
+    VkFormat get_decompressed_format (VkFormat format) noexcept;
+
+    /**
+     * Encodes 8-bit RGBA texels, row by row, into BC1 or BC3 blocks. The
+     * endpoints of each block span the bounding box of its colors.
+     */
+    std::vector<unsigned char> encode_blocks (VkFormat format,
+                                              const unsigned char *texels,
+                                              uint32_t width,
+                                              uint32_t height);
+    /**
+     * Decodes BC1 or BC3 blocks into 8-bit RGBA texels for devices that
+     * cannot sample the format. Each row of blocks is decoded aside and then
+     * written out in order, whole texel rows at a time, so *texels* may be
+     * mapped staging memory.
+     *
+     * @param texels Room for width * height * 4 bytes.
+     */
+    void decode_blocks (VkFormat format,
+                        const unsigned char *blocks,
+                        uint32_t width,
+                        uint32_t height,
+                        unsigned char *texels);
+}
+
+#endif /* __VKTEST_BLOCKCOMPRESSION_HPP__ */
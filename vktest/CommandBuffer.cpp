@@ -2,8 +2,14 @@
 #include <stdexcept>
 #include <algorithm>
 
+namespace vktest {
+    static VkImageSubresourceRange to_range (const VkImageSubresourceLayers &layers) noexcept {
+        return VkImageSubresourceRange { layers.aspectMask, layers.mipLevel, 1, layers.baseArrayLayer, layers.layerCount };
+    }
+}
+
 vktest::CommandBuffer::CommandBuffer (const CommandPool &pool, VkCommandBufferLevel level)
-        : _pool {&pool} {
+        : _pool {&pool}, _pending_memory_barriers {}, _pending_buffer_barriers {}, _pending_image_barriers {} {
     VkCommandBufferAllocateInfo alloc_info {};
     alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     alloc_info.commandPool = pool.get_native();
@@ -13,7 +19,10 @@ vktest::CommandBuffer::CommandBuffer (const CommandPool &pool, VkCommandBufferLe
     if (res != VK_SUCCESS) throw std::runtime_error("Failed to allocate command buffer");
 }
 
-vktest::CommandBuffer::CommandBuffer (CommandBuffer &&other) noexcept {
+vktest::CommandBuffer::CommandBuffer (CommandBuffer &&other) noexcept
+        : _pending_memory_barriers (std::move(other._pending_memory_barriers)),
+          _pending_buffer_barriers (std::move(other._pending_buffer_barriers)),
+          _pending_image_barriers (std::move(other._pending_image_barriers)) {
     _native = other._native;
     _pool = other._pool;
     other._native = nullptr;
@@ -71,10 +80,39 @@ void vktest::CommandBuffer::begin_render_pass (const RenderPass &render_pass,
     vkCmdBeginRenderPass(_native, &info, VK_SUBPASS_CONTENTS_INLINE);
 }
 
+void vktest::CommandBuffer::begin_rendering (const VkRect2D &render_area,
+                                             const std::vector<VkRenderingAttachmentInfo> &color_attachments,
+                                             const VkRenderingAttachmentInfo *depth_attachment) const noexcept {
+    VkRenderingInfo info {};
+    info.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    info.renderArea = render_area;
+    info.layerCount = 1;
+    info.colorAttachmentCount = static_cast<uint32_t>(color_attachments.size());
+    info.pColorAttachments = color_attachments.data();
+    info.pDepthAttachment = depth_attachment;
+    _pool->get_device().get_dispatch().cmd_begin_rendering(_native, &info);
+}
+
+void vktest::CommandBuffer::end_rendering () const noexcept {
+    _pool->get_device().get_dispatch().cmd_end_rendering(_native);
+}
+
 void vktest::CommandBuffer::bind_pipeline (const Pipeline &pipeline, VkPipelineBindPoint bind_point) const noexcept {
     vkCmdBindPipeline(_native, bind_point, pipeline.get_native());
 }
 
+void vktest::CommandBuffer::bind_pipeline (const ComputePipeline &pipeline) const noexcept {
+    vkCmdBindPipeline(_native, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.get_native());
+}
+
+void vktest::CommandBuffer::set_viewport (const VkViewport &viewport) const noexcept {
+    vkCmdSetViewport(_native, 0, 1, &viewport);
+}
+
+void vktest::CommandBuffer::set_scissor (const VkRect2D &scissor) const noexcept {
+    vkCmdSetScissor(_native, 0, 1, &scissor);
+}
+
 void vktest::CommandBuffer::bind_vertex_buffers (uint32_t first_binding,
                                                  uint32_t binding_count,
                                                  const std::vector<VkBuffer> &buffers,
@@ -86,6 +124,22 @@ void vktest::CommandBuffer::bind_index_buffer (const Buffer &buffer, VkDeviceSiz
     vkCmdBindIndexBuffer(_native, buffer.get_native(), offset, index_type);
 }
 
+void vktest::CommandBuffer::bind_descriptor_sets (VkPipelineBindPoint bind_point,
+                                                  const PipelineLayout &layout,
+                                                  uint32_t first_set,
+                                                  const std::vector<VkDescriptorSet> &sets) const noexcept {
+    vkCmdBindDescriptorSets(_native, bind_point, layout.get_native(), first_set,
+                            static_cast<uint32_t>(sets.size()), sets.data(), 0, nullptr);
+}
+
+void vktest::CommandBuffer::push_descriptor_set (VkPipelineBindPoint bind_point,
+                                                 const PipelineLayout &layout,
+                                                 uint32_t set,
+                                                 const std::vector<VkWriteDescriptorSet> &writes) const noexcept {
+    _pool->get_device().get_dispatch().cmd_push_descriptor_set(_native, bind_point, layout.get_native(), set,
+                                                               static_cast<uint32_t>(writes.size()), writes.data());
+}
+
 void vktest::CommandBuffer::draw (uint32_t vertex_count,
                                   uint32_t instance_count,
                                   uint32_t first_vertex,
@@ -101,6 +155,36 @@ void vktest::CommandBuffer::draw_indexed (uint32_t index_count,
     vkCmdDrawIndexed(_native, index_count, instance_count, first_index, vertex_offset, first_instance);
 }
 
+void vktest::CommandBuffer::draw_indexed_indirect (const Buffer &buffer,
+                                                   VkDeviceSize offset,
+                                                   uint32_t draw_count,
+                                                   uint32_t stride) const noexcept {
+    vkCmdDrawIndexedIndirect(_native, buffer.get_native(), offset, draw_count, stride);
+}
+
+void vktest::CommandBuffer::draw_indexed_indirect_count (const Buffer &buffer,
+                                                         VkDeviceSize offset,
+                                                         const Buffer &count_buffer,
+                                                         VkDeviceSize count_offset,
+                                                         uint32_t max_draw_count,
+                                                         uint32_t stride) const noexcept {
+    vkCmdDrawIndexedIndirectCount(_native, buffer.get_native(), offset,
+                                  count_buffer.get_native(), count_offset,
+                                  max_draw_count, stride);
+}
+
+void vktest::CommandBuffer::dispatch (uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z) const noexcept {
+    vkCmdDispatch(_native, group_count_x, group_count_y, group_count_z);
+}
+
+void vktest::CommandBuffer::fill_buffer (const Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t data) const noexcept {
+    vkCmdFillBuffer(_native, buffer.get_native(), offset, size, data);
+}
+
+void vktest::CommandBuffer::next_subpass () const noexcept {
+    vkCmdNextSubpass(_native, VK_SUBPASS_CONTENTS_INLINE);
+}
+
 void vktest::CommandBuffer::end_render_pass () const noexcept {
     vkCmdEndRenderPass(_native);
 }
@@ -113,6 +197,11 @@ void vktest::CommandBuffer::copy_buffer (
 void vktest::CommandBuffer::copy_buffer (
         const Buffer &src, const Image &dest, VkImageLayout dest_layout,
         const std::vector<VkBufferImageCopy> &regions) const noexcept {
+    for (const VkBufferImageCopy &region : regions) {
+        transition_image(dest, dest_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         false, to_range(region.imageSubresource));
+    }
+    flush_barriers();
     vkCmdCopyBufferToImage(_native, src.get_native(), dest.get_native(), dest_layout, static_cast<uint32_t>(regions.size()), regions.data());
 }
 
@@ -168,19 +257,183 @@ void vktest::CommandBuffer::blit_image (const Image &src, VkImageLayout src_layo
                                         const Image &dest, VkImageLayout dest_layout,
                                         const std::vector<VkImageBlit> &regions,
                                         VkFilter filter) const noexcept {
+    for (const VkImageBlit &region : regions) {
+        transition_image(src, src_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                         false, to_range(region.srcSubresource));
+        transition_image(dest, dest_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         false, to_range(region.dstSubresource));
+    }
+    flush_barriers();
+    blit_image(src.get_native(), src_layout, dest.get_native(), dest_layout, regions, filter);
+}
+
+void vktest::CommandBuffer::blit_image (VkImage src, VkImageLayout src_layout,
+                                        VkImage dest, VkImageLayout dest_layout,
+                                        const std::vector<VkImageBlit> &regions,
+                                        VkFilter filter) const noexcept {
     uint32_t region_count = static_cast<uint32_t>(regions.size());
     vkCmdBlitImage(_native,
-                   src.get_native(), src_layout,
-                   dest.get_native(), dest_layout,
+                   src, src_layout,
+                   dest, dest_layout,
                    region_count, regions.data(),
                    filter);
 }
 
+void vktest::CommandBuffer::copy_image (const Image &src, VkImageLayout src_layout,
+                                        const Image &dest, VkImageLayout dest_layout,
+                                        const std::vector<VkImageCopy> &regions) const noexcept {
+    for (const VkImageCopy &region : regions) {
+        transition_image(src, src_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                         false, to_range(region.srcSubresource));
+        transition_image(dest, dest_layout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+                         false, to_range(region.dstSubresource));
+    }
+    flush_barriers();
+    vkCmdCopyImage(_native,
+                   src.get_native(), src_layout,
+                   dest.get_native(), dest_layout,
+                   static_cast<uint32_t>(regions.size()), regions.data());
+}
+
+void vktest::CommandBuffer::reset_query_pool (const QueryPool &pool, uint32_t first_query, uint32_t query_count) const noexcept {
+    vkCmdResetQueryPool(_native, pool.get_native(), first_query, query_count);
+}
+
+void vktest::CommandBuffer::write_timestamp (VkPipelineStageFlagBits stage, const QueryPool &pool, uint32_t query) const noexcept {
+    vkCmdWriteTimestamp(_native, stage, pool.get_native(), query);
+}
+
+void vktest::CommandBuffer::transition_image (const Image &image,
+                                              VkImageLayout layout,
+                                              VkPipelineStageFlags stages,
+                                              VkAccessFlags access,
+                                              bool discard,
+                                              std::optional<VkImageSubresourceRange> range) const {
+    ImageState &state = image.get_state();
+    state.transition(image.get_native(),
+                     range ? *range : state.get_full_range(),
+                     ImageAccess { layout, stages, access },
+                     discard,
+                     _pending_image_barriers);
+}
+
+void vktest::CommandBuffer::add_memory_barrier (VkPipelineStageFlags src_stage_mask,
+                                                VkAccessFlags src_access_mask,
+                                                VkPipelineStageFlags dest_stage_mask,
+                                                VkAccessFlags dest_access_mask) const {
+    VkMemoryBarrier2 barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stage_mask;
+    barrier.srcAccessMask = src_access_mask;
+    barrier.dstStageMask = dest_stage_mask;
+    barrier.dstAccessMask = dest_access_mask;
+    _pending_memory_barriers.push_back(barrier);
+}
+
+void vktest::CommandBuffer::add_buffer_barrier (const Buffer &buffer,
+                                                VkDeviceSize offset,
+                                                VkDeviceSize size,
+                                                VkPipelineStageFlags src_stage_mask,
+                                                VkAccessFlags src_access_mask,
+                                                VkPipelineStageFlags dest_stage_mask,
+                                                VkAccessFlags dest_access_mask) const {
+    VkBufferMemoryBarrier2 barrier {};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    barrier.srcStageMask = src_stage_mask;
+    barrier.srcAccessMask = src_access_mask;
+    barrier.dstStageMask = dest_stage_mask;
+    barrier.dstAccessMask = dest_access_mask;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = buffer.get_native();
+    barrier.offset = offset;
+    barrier.size = size;
+    _pending_buffer_barriers.push_back(barrier);
+}
+
+void vktest::CommandBuffer::add_image_barrier (const VkImageMemoryBarrier2 &barrier) const {
+    _pending_image_barriers.push_back(barrier);
+}
+
+void vktest::CommandBuffer::flush_barriers () const noexcept {
+    if (_pending_memory_barriers.empty() && _pending_buffer_barriers.empty() && _pending_image_barriers.empty()) {
+        return;
+    }
+
+    const DeviceDispatch &dispatch = _pool->get_device().get_dispatch();
+    if (dispatch.cmd_pipeline_barrier2 != nullptr) {
+        VkDependencyInfo dependency_info {};
+        dependency_info.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependency_info.memoryBarrierCount = static_cast<uint32_t>(_pending_memory_barriers.size());
+        dependency_info.pMemoryBarriers = _pending_memory_barriers.data();
+        dependency_info.bufferMemoryBarrierCount = static_cast<uint32_t>(_pending_buffer_barriers.size());
+        dependency_info.pBufferMemoryBarriers = _pending_buffer_barriers.data();
+        dependency_info.imageMemoryBarrierCount = static_cast<uint32_t>(_pending_image_barriers.size());
+        dependency_info.pImageMemoryBarriers = _pending_image_barriers.data();
+        dispatch.cmd_pipeline_barrier2(_native, &dependency_info);
+    } else {
+        // Only the stages and accesses that also exist in the original flags
+        // are ever queued, so the lower 32 bits hold all of them.
+        VkPipelineStageFlags src_stage_mask = 0;
+        VkPipelineStageFlags dest_stage_mask = 0;
+        std::vector<VkMemoryBarrier> memory_barriers {};
+        for (const VkMemoryBarrier2 &barrier2 : _pending_memory_barriers) {
+            VkMemoryBarrier barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+            src_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+            dest_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+            memory_barriers.push_back(barrier);
+        }
+        std::vector<VkBufferMemoryBarrier> buffer_barriers {};
+        for (const VkBufferMemoryBarrier2 &barrier2 : _pending_buffer_barriers) {
+            VkBufferMemoryBarrier barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+            barrier.srcQueueFamilyIndex = barrier2.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = barrier2.dstQueueFamilyIndex;
+            barrier.buffer = barrier2.buffer;
+            barrier.offset = barrier2.offset;
+            barrier.size = barrier2.size;
+            src_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+            dest_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+            buffer_barriers.push_back(barrier);
+        }
+        std::vector<VkImageMemoryBarrier> image_barriers {};
+        for (const VkImageMemoryBarrier2 &barrier2 : _pending_image_barriers) {
+            VkImageMemoryBarrier barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcAccessMask = static_cast<VkAccessFlags>(barrier2.srcAccessMask);
+            barrier.dstAccessMask = static_cast<VkAccessFlags>(barrier2.dstAccessMask);
+            barrier.oldLayout = barrier2.oldLayout;
+            barrier.newLayout = barrier2.newLayout;
+            barrier.srcQueueFamilyIndex = barrier2.srcQueueFamilyIndex;
+            barrier.dstQueueFamilyIndex = barrier2.dstQueueFamilyIndex;
+            barrier.image = barrier2.image;
+            barrier.subresourceRange = barrier2.subresourceRange;
+            src_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.srcStageMask);
+            dest_stage_mask |= static_cast<VkPipelineStageFlags>(barrier2.dstStageMask);
+            image_barriers.push_back(barrier);
+        }
+        // Empty stage masks are not allowed here.
+        if (src_stage_mask == 0) src_stage_mask = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        if (dest_stage_mask == 0) dest_stage_mask = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        pipeline_barrier(src_stage_mask, dest_stage_mask, 0, &memory_barriers, &buffer_barriers, &image_barriers);
+    }
+
+    _pending_memory_barriers.clear();
+    _pending_buffer_barriers.clear();
+    _pending_image_barriers.clear();
+}
+
 void vktest::CommandBuffer::end () const {
     VkResult res = vkEndCommandBuffer(_native);
     if (res != VK_SUCCESS) throw std::runtime_error("Failed to record command buffer");
 }
 
 vktest::CommandBuffer::CommandBuffer (const CommandPool &pool, VkCommandBuffer native) noexcept
-        : _native {native}, _pool {&pool} {
+        : _native {native}, _pool {&pool},
+          _pending_memory_barriers {}, _pending_buffer_barriers {}, _pending_image_barriers {} {
 }
@@ -9,9 +9,12 @@
 #include "RenderPass.hpp"
 #include "Framebuffer.hpp"
 #include "Pipeline.hpp"
+#include "ComputePipeline.hpp"
+#include "PipelineLayout.hpp"
 #include "Buffer.hpp"
 #include "DescriptorSet.hpp"
 #include "Image.hpp"
+#include "QueryPool.hpp"
 
 namespace vktest {
     class CommandPool;
@@ -28,13 +31,42 @@ namespace vktest {
         void begin_render_pass (const RenderPass &render_pass,
                                 const Framebuffer &framebuffer,
                                 VkRect2D render_area) const noexcept;
+        /**
+         * Begins dynamic rendering into the given attachments, without a
+         * render pass or framebuffer. The attachments must already be in the
+         * layouts given in their infos. Requires the dynamicRendering feature.
+         */
+        void begin_rendering (const VkRect2D &render_area,
+                              const std::vector<VkRenderingAttachmentInfo> &color_attachments,
+                              const VkRenderingAttachmentInfo *depth_attachment) const noexcept;
+        void end_rendering () const noexcept;
         void bind_pipeline (const Pipeline &pipeline, VkPipelineBindPoint bind_point = VK_PIPELINE_BIND_POINT_GRAPHICS) const noexcept;
+        void bind_pipeline (const ComputePipeline &pipeline) const noexcept;
+        /**
+         * Sets the viewport and the scissor of pipelines created with
+         * dynamic viewport state.
+         */
+        void set_viewport (const VkViewport &viewport) const noexcept;
+        void set_scissor (const VkRect2D &scissor) const noexcept;
         void bind_vertex_buffers (uint32_t first_binding,
                                   uint32_t binding_count,
                                   const std::vector<VkBuffer> &buffers,
                                   const std::vector<VkDeviceSize> &offsets) const noexcept;
         void bind_index_buffer (const Buffer &buffer, VkDeviceSize offset, VkIndexType index_type) const noexcept;
-        // void bind_descriptor_sets ( /* TODO */ ) const noexcept;
+        void bind_descriptor_sets (VkPipelineBindPoint bind_point,
+                                   const PipelineLayout &layout,
+                                   uint32_t first_set,
+                                   const std::vector<VkDescriptorSet> &sets) const noexcept;
+        /**
+         * Writes the descriptors of *set* straight into the command buffer.
+         * The set layout must have been created with
+         * VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR; the dstSet
+         * of the writes is ignored. Requires VK_KHR_push_descriptor.
+         */
+        void push_descriptor_set (VkPipelineBindPoint bind_point,
+                                  const PipelineLayout &layout,
+                                  uint32_t set,
+                                  const std::vector<VkWriteDescriptorSet> &writes) const noexcept;
         void draw (uint32_t vertex_count,
                    uint32_t instance_count,
                    uint32_t first_vertex,
@@ -44,9 +76,36 @@ namespace vktest {
                    uint32_t first_index,
                    int32_t vertex_offset,
                    uint32_t first_instance) const noexcept;
+        /**
+         * Draws *draw_count* VkDrawIndexedIndirectCommand entries read from
+         * *buffer*. Requires the multiDrawIndirect feature if *draw_count* is
+         * greater than 1.
+         */
+        void draw_indexed_indirect (const Buffer &buffer,
+                                    VkDeviceSize offset,
+                                    uint32_t draw_count,
+                                    uint32_t stride) const noexcept;
+        /**
+         * Like *draw_indexed_indirect*, but the draw count is read from
+         * *count_buffer* when the command executes, clamped to
+         * *max_draw_count*. Requires the drawIndirectCount feature.
+         */
+        void draw_indexed_indirect_count (const Buffer &buffer,
+                                          VkDeviceSize offset,
+                                          const Buffer &count_buffer,
+                                          VkDeviceSize count_offset,
+                                          uint32_t max_draw_count,
+                                          uint32_t stride) const noexcept;
+        void dispatch (uint32_t group_count_x, uint32_t group_count_y, uint32_t group_count_z) const noexcept;
+        void fill_buffer (const Buffer &buffer, VkDeviceSize offset, VkDeviceSize size, uint32_t data) const noexcept;
+        void next_subpass () const noexcept;
         void end_render_pass () const noexcept;
         void copy_buffer (const Buffer &src, const Buffer &dest,
                           const std::vector<VkBufferCopy> &regions) const noexcept;
+        /**
+         * Transitions the copied subresources of *dest* to *dest_layout*
+         * first, if needed.
+         */
         void copy_buffer (const Buffer &src, const Image &dest, VkImageLayout dest_layout,
                           const std::vector<VkBufferImageCopy> &regions) const noexcept;
         void pipeline_barrier (VkPipelineStageFlags src_stage_mask,
@@ -74,10 +133,75 @@ namespace vktest {
                                const std::vector<VkMemoryBarrier> *memory_barriers,
                                const std::vector<VkBufferMemoryBarrier> *buffer_barriers,
                                const std::vector<VkImageMemoryBarrier> *image_barriers) const noexcept;
+        /**
+         * Transitions the blitted subresources of *src* and *dest* to
+         * *src_layout* and *dest_layout* first, if needed.
+         */
         void blit_image (const Image &src, VkImageLayout src_layout,
                          const Image &dest, VkImageLayout dest_layout,
                          const std::vector<VkImageBlit> &regions,
                          VkFilter filter) const noexcept;
+        // For images not owned by an Image, such as the swap chain images.
+        void blit_image (VkImage src, VkImageLayout src_layout,
+                         VkImage dest, VkImageLayout dest_layout,
+                         const std::vector<VkImageBlit> &regions,
+                         VkFilter filter) const noexcept;
+        /**
+         * Transitions the copied subresources of *src* and *dest* to
+         * *src_layout* and *dest_layout* first, if needed.
+         */
+        void copy_image (const Image &src, VkImageLayout src_layout,
+                         const Image &dest, VkImageLayout dest_layout,
+                         const std::vector<VkImageCopy> &regions) const noexcept;
+        void reset_query_pool (const QueryPool &pool, uint32_t first_query, uint32_t query_count) const noexcept;
+        /**
+         * Writes the time at which all previous commands have completed
+         * *stage* into the query.
+         */
+        void write_timestamp (VkPipelineStageFlagBits stage, const QueryPool &pool, uint32_t query) const noexcept;
+        /**
+         * Queues the barriers that make *range* of *image* (all of it by
+         * default) ready to be accessed in *layout* by *stages* with *access*,
+         * based on the state tracked by the image. Nothing is recorded until
+         * *flush_barriers*.
+         *
+         * @param discard The current contents are not needed.
+         */
+        void transition_image (const Image &image,
+                               VkImageLayout layout,
+                               VkPipelineStageFlags stages,
+                               VkAccessFlags access,
+                               bool discard = false,
+                               std::optional<VkImageSubresourceRange> range = std::nullopt) const;
+        /**
+         * Queues a global memory barrier.
+         */
+        void add_memory_barrier (VkPipelineStageFlags src_stage_mask,
+                                 VkAccessFlags src_access_mask,
+                                 VkPipelineStageFlags dest_stage_mask,
+                                 VkAccessFlags dest_access_mask) const;
+        /**
+         * Queues a barrier for a range of *buffer*.
+         */
+        void add_buffer_barrier (const Buffer &buffer,
+                                 VkDeviceSize offset,
+                                 VkDeviceSize size,
+                                 VkPipelineStageFlags src_stage_mask,
+                                 VkAccessFlags src_access_mask,
+                                 VkPipelineStageFlags dest_stage_mask,
+                                 VkAccessFlags dest_access_mask) const;
+        /**
+         * Queues a barrier for an image that is not tracked, such as a swap
+         * chain image.
+         */
+        void add_image_barrier (const VkImageMemoryBarrier2 &barrier) const;
+        /**
+         * Records all queued barriers at once. Each barrier keeps its own
+         * stage masks with VK_KHR_synchronization2. Without it, the barriers
+         * are recorded with a single vkCmdPipelineBarrier that waits on the
+         * union of their stages.
+         */
+        void flush_barriers () const noexcept;
         void end () const;
 
     private:
@@ -87,6 +211,11 @@ namespace vktest {
         // pool are freed.
         VkCommandBuffer _native;
         const CommandPool *_pool;
+        // Barriers queued until *flush_barriers*, recording the commands does
+        // not change the handle itself.
+        mutable std::vector<VkMemoryBarrier2> _pending_memory_barriers;
+        mutable std::vector<VkBufferMemoryBarrier2> _pending_buffer_barriers;
+        mutable std::vector<VkImageMemoryBarrier2> _pending_image_barriers;
 
         friend class CommandPool;
     };
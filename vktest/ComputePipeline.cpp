@@ -0,0 +1,35 @@
+#include "ComputePipeline.hpp"
+#include <stdexcept>
+
+vktest::ComputePipeline::ComputePipeline (const PipelineLayout &layout, const VkPipelineShaderStageCreateInfo &stage)
+        : _layout {&layout} {
+    // Compute pipelines have no fixed-function state; the shader stage and
+    // the layout are all there is.
+    VkComputePipelineCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    create_info.stage = stage;
+    create_info.layout = _layout->get_native();
+    create_info.basePipelineHandle = VK_NULL_HANDLE; // Optional
+    create_info.basePipelineIndex = -1; // Optional
+
+    VkResult res = vkCreateComputePipelines(_layout->get_device().get_native(), VK_NULL_HANDLE, 1, &create_info, nullptr, &_native);
+    if (res != VK_SUCCESS) throw std::runtime_error("Failed to create compute pipeline");
+}
+
+vktest::ComputePipeline::ComputePipeline (ComputePipeline &&other) noexcept {
+    _native = other._native;
+    _layout = other._layout;
+    other._native = nullptr;
+}
+
+vktest::ComputePipeline::~ComputePipeline () {
+    if (_native != nullptr) vkDestroyPipeline(_layout->get_device().get_native(), _native, nullptr);
+}
+
+VkPipeline vktest::ComputePipeline::get_native () const noexcept {
+    return _native;
+}
+
+const vktest::PipelineLayout &vktest::ComputePipeline::get_layout () const noexcept {
+    return *_layout;
+}
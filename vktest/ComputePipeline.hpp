@@ -0,0 +1,27 @@
+#ifndef __VKTEST_COMPUTEPIPELINE_HPP__
+#define __VKTEST_COMPUTEPIPELINE_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include "PipelineLayout.hpp"
+
+namespace vktest {
+    /**
+     * A pipeline with a single compute shader stage.
+     */
+    class ComputePipeline {
+    public:
+        ComputePipeline (const PipelineLayout &layout, const VkPipelineShaderStageCreateInfo &stage);
+        ComputePipeline (const ComputePipeline &) = delete;
+        ComputePipeline (ComputePipeline &&other) noexcept;
+        ~ComputePipeline ();
+        VkPipeline get_native () const noexcept;
+        const PipelineLayout &get_layout () const noexcept;
+
+    private:
+        VkPipeline _native;
+        const PipelineLayout *_layout;
+    };
+}
+
+#endif /* __VKTEST_COMPUTEPIPELINE_HPP__ */
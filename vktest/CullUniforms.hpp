@@ -0,0 +1,32 @@
+#ifndef __VKTEST_CULLUNIFORMS_HPP__
+#define __VKTEST_CULLUNIFORMS_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace vktest {
+    /**
+     * Per-frame parameters of the culling compute shader (data/cull.comp).
+     * Follows the std140 layout rules.
+     */
+    struct CullUniforms {
+        alignas(16) glm::mat4 view;
+        // Applied before the transform of each object, like *ubo.model*.
+        alignas(16) glm::mat4 model;
+        alignas(16) glm::mat4 proj;
+        alignas(16) glm::vec4 frustum[6];
+        float pixel_scale;
+        float pixel_error;
+        uint32_t object_count;
+        uint32_t lod_count;
+        uint32_t compact;
+        uint32_t occlusion;
+        alignas(8) glm::vec2 pyramid_size;
+        alignas(8) glm::vec2 pyramid_uv_scale;
+    };
+}
+
+#endif /* __VKTEST_CULLUNIFORMS_HPP__ */
@@ -0,0 +1,27 @@
+#include "DeletionQueue.hpp"
+
+vktest::DeletionQueue::DeletionQueue () noexcept : _entries {} {
+}
+
+vktest::DeletionQueue::DeletionQueue (DeletionQueue &&other) noexcept
+        : _entries (std::move(other._entries)) {
+}
+
+vktest::DeletionQueue::~DeletionQueue () {
+    clear();
+}
+
+void vktest::DeletionQueue::collect (uint64_t completed_frame) noexcept {
+    while (!_entries.empty() && _entries.front().frame <= completed_frame) {
+        _entries.pop_front();
+    }
+}
+
+void vktest::DeletionQueue::clear () noexcept {
+    // In order, like *collect*.
+    while (!_entries.empty()) _entries.pop_front();
+}
+
+size_t vktest::DeletionQueue::size () const noexcept {
+    return _entries.size();
+}
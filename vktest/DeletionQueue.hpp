@@ -0,0 +1,63 @@
+#ifndef __VKTEST_DELETIONQUEUE_HPP__
+#define __VKTEST_DELETIONQUEUE_HPP__
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+
+namespace vktest {
+    /**
+     * Keeps objects alive until the GPU has completed the frames that may
+     * still use them, so they can be replaced without waiting for the device
+     * to become idle.
+     *
+     * Frames are numbered in the order they are submitted to a single queue,
+     * so once a frame has completed all the frames before it have as well.
+     */
+    class DeletionQueue {
+    public:
+        DeletionQueue () noexcept;
+        DeletionQueue (const DeletionQueue &) = delete;
+        DeletionQueue (DeletionQueue &&other) noexcept;
+        ~DeletionQueue ();
+        /**
+         * Takes over the object, which is destroyed once *frame* completes.
+         * Objects retired for the same frame are destroyed in the order they
+         * were retired, so an object goes before what it was created from.
+         *
+         * @param frame The last submitted frame that may use the object.
+         */
+        template <typename T>
+        void retire (uint64_t frame, T &&object);
+        /**
+         * Destroys the objects of the frames up to *completed_frame*.
+         */
+        void collect (uint64_t completed_frame) noexcept;
+        /**
+         * Destroys all objects, once the device is idle.
+         */
+        void clear () noexcept;
+        size_t size () const noexcept;
+
+    private:
+        struct Retired {
+            virtual ~Retired () = default;
+        };
+        template <typename T>
+        struct RetiredObject : Retired {
+            RetiredObject (T &&object) : object {std::move(object)} {}
+            T object;
+        };
+        struct Entry {
+            uint64_t frame;
+            std::unique_ptr<Retired> retired;
+        };
+
+        // In the order of the frames.
+        std::deque<Entry> _entries;
+    };
+}
+
+#include "DeletionQueue.tpp"
+
+#endif /* __VKTEST_DELETIONQUEUE_HPP__ */
@@ -0,0 +1,11 @@
+#include <type_traits>
+#include <utility>
+
+template <typename T>
+void vktest::DeletionQueue::retire (uint64_t frame, T &&object) {
+    static_assert(!std::is_lvalue_reference_v<T>, "Retired objects have to be moved in");
+    // The entries stay sorted by frame, so *collect* only looks at the front.
+    // Raising the frame only delays the destruction.
+    if (!_entries.empty() && frame < _entries.back().frame) frame = _entries.back().frame;
+    _entries.push_back(Entry { frame, std::make_unique<RetiredObject<T>>(std::move(object)) });
+}
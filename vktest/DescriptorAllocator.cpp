@@ -0,0 +1,68 @@
+#include "DescriptorAllocator.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace vktest {
+    // The pools grow until they hold this many sets.
+    static const uint32_t MAX_POOL_SET_COUNT = 4096;
+}
+
+vktest::DescriptorAllocator::DescriptorAllocator (const Device &device,
+                                                  const std::vector<VkDescriptorPoolSize> &sizes_per_set,
+                                                  uint32_t initial_set_count)
+        : _device {&device},
+          _sizes_per_set {sizes_per_set},
+          _next_set_count {std::max(initial_set_count, 1u)},
+          _pools {},
+          _current {0} {
+}
+
+vktest::DescriptorAllocator::DescriptorAllocator (DescriptorAllocator &&other) noexcept
+        : _device {other._device},
+          _sizes_per_set (std::move(other._sizes_per_set)),
+          _next_set_count {other._next_set_count},
+          _pools (std::move(other._pools)),
+          _current {other._current} {
+}
+
+VkDescriptorSet vktest::DescriptorAllocator::allocate (const DescriptorSetLayout &layout) {
+    VkDescriptorSetLayout native_layout = layout.get_native();
+    VkDescriptorSetAllocateInfo alloc_info {};
+    alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    alloc_info.descriptorSetCount = 1;
+    alloc_info.pSetLayouts = &native_layout;
+
+    // A full pool stays full until the next reset, so the allocation moves
+    // on to the next pool, which is added if needed. A fresh pool only fails
+    // if the set does not fit into it at all.
+    for (;;) {
+        bool fresh = _current == _pools.size();
+        if (fresh) add_pool();
+        alloc_info.descriptorPool = _pools[_current]->get_native();
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkResult res = vkAllocateDescriptorSets(_device->get_native(), &alloc_info, &set);
+        if (res == VK_SUCCESS) return set;
+        if (fresh || (res != VK_ERROR_OUT_OF_POOL_MEMORY && res != VK_ERROR_FRAGMENTED_POOL)) {
+            throw std::runtime_error("Failed to allocate descriptor set");
+        }
+        _current++;
+    }
+}
+
+void vktest::DescriptorAllocator::reset () noexcept {
+    for (size_t i = 0; i < std::min(_current + 1, _pools.size()); i++) _pools[i]->reset();
+    _current = 0;
+}
+
+size_t vktest::DescriptorAllocator::get_pool_count () const noexcept {
+    return _pools.size();
+}
+
+void vktest::DescriptorAllocator::add_pool () {
+    std::vector<VkDescriptorPoolSize> pool_sizes (_sizes_per_set);
+    for (VkDescriptorPoolSize &size : pool_sizes) size.descriptorCount *= _next_set_count;
+    // Without VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT, the driver can
+    // allocate from the pool linearly.
+    _pools.push_back( std::make_unique<DescriptorPool>(*_device, _next_set_count, pool_sizes, 0) );
+    _next_set_count = std::min(_next_set_count * 2, MAX_POOL_SET_COUNT);
+}
@@ -0,0 +1,56 @@
+#ifndef __VKTEST_DESCRIPTORALLOCATOR_HPP__
+#define __VKTEST_DESCRIPTORALLOCATOR_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <vector>
+#include "Device.hpp"
+#include "DescriptorPool.hpp"
+#include "DescriptorSetLayout.hpp"
+
+namespace vktest {
+    /**
+     * Allocates descriptor sets that only live until the next *reset*, such
+     * as the sets of a frame. The sets are allocated linearly from pools that
+     * cannot free single sets, and a new, larger pool is added whenever the
+     * current one runs out, so allocating never fails for lack of space.
+     * Resetting returns all sets of all pools at once.
+     */
+    class DescriptorAllocator {
+    public:
+        /**
+         * @param sizes_per_set The descriptors of each type an average set
+         * takes. A pool for n sets holds n times as many.
+         * @param initial_set_count The sets of the first pool.
+         */
+        DescriptorAllocator (const Device &device,
+                             const std::vector<VkDescriptorPoolSize> &sizes_per_set,
+                             uint32_t initial_set_count);
+        DescriptorAllocator (const DescriptorAllocator &) = delete;
+        DescriptorAllocator (DescriptorAllocator &&other) noexcept;
+        /**
+         * @return A set that is valid until the next *reset*. It does not
+         * have to be freed.
+         */
+        VkDescriptorSet allocate (const DescriptorSetLayout &layout);
+        /**
+         * Only valid once the sets are no longer used by pending commands.
+         */
+        void reset () noexcept;
+        size_t get_pool_count () const noexcept;
+
+    private:
+        void add_pool ();
+
+        const Device *_device;
+        std::vector<VkDescriptorPoolSize> _sizes_per_set;
+        uint32_t _next_set_count;
+        // The pools in the order they were added; the ones before *_current*
+        // are full until the next reset.
+        std::vector<std::unique_ptr<DescriptorPool>> _pools;
+        size_t _current;
+    };
+}
+
+#endif /* __VKTEST_DESCRIPTORALLOCATOR_HPP__ */
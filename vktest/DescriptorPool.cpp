@@ -3,13 +3,16 @@
 #include <algorithm>
 
 vktest::DescriptorPool::DescriptorPool (
-        const Device &device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize> &pool_sizes)
-        : _device {&device}{
+        const Device &device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize> &pool_sizes,
+        VkDescriptorPoolCreateFlags flags)
+        : _device {&device}, _flags {flags} {
     VkDescriptorPoolCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
     // VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT: Individual descriptor
     // sets can be freed using vkFreeDescriptorSets.
-    create_info.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    // VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT: Required for sets
+    // whose layout has update-after-bind bindings.
+    create_info.flags = flags;
     create_info.maxSets = max_sets;
     create_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
     create_info.pPoolSizes = pool_sizes.data();
@@ -21,6 +24,7 @@ vktest::DescriptorPool::DescriptorPool (
 vktest::DescriptorPool::DescriptorPool (DescriptorPool &&other) noexcept {
     _native = other._native;
     _device = other._device;
+    _flags = other._flags;
     other._native = nullptr;
 }
 
@@ -36,6 +40,10 @@ const vktest::Device &vktest::DescriptorPool::get_device () const noexcept {
     return *_device;
 }
 
+VkDescriptorPoolCreateFlags vktest::DescriptorPool::get_flags () const noexcept {
+    return _flags;
+}
+
 std::vector<vktest::DescriptorSet> vktest::DescriptorPool::allocate_descriptor_sets (
         const std::vector<DescriptorSetLayout*> &layouts) const {
     std::vector<VkDescriptorSetLayout> native_layouts (layouts.size());
@@ -82,3 +90,7 @@ void vktest::DescriptorPool::free_descriptor_sets (const std::vector<DescriptorS
     }
     vkFreeDescriptorSets(_device->get_native(), _native, static_cast<uint32_t>(native_sets.size()), native_sets.data());
 }
+
+void vktest::DescriptorPool::reset () const noexcept {
+    vkResetDescriptorPool(_device->get_native(), _native, 0);
+}
@@ -13,19 +13,32 @@ namespace vktest {
 
     class DescriptorPool {
     public:
-        DescriptorPool (const Device &device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize> &pool_sizes);
+        /**
+         * @param flags Without VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT
+         * the sets are only returned all at once, when the pool is reset or
+         * destroyed, and the driver can allocate them linearly.
+         */
+        DescriptorPool (const Device &device, uint32_t max_sets, const std::vector<VkDescriptorPoolSize> &pool_sizes,
+                        VkDescriptorPoolCreateFlags flags = 0);
         DescriptorPool (const DescriptorPool &) = delete;
         DescriptorPool (DescriptorPool &&other) noexcept;
         ~DescriptorPool ();
         VkDescriptorPool get_native () const noexcept;
         const Device &get_device () const noexcept;
+        VkDescriptorPoolCreateFlags get_flags () const noexcept;
         std::vector<DescriptorSet> allocate_descriptor_sets (const std::vector<DescriptorSetLayout*> &layouts) const;
         void free_descriptor_sets (std::vector<DescriptorSet> &sets) const noexcept;
         void free_descriptor_sets (const std::vector<DescriptorSet*> &sets) const noexcept;
+        /**
+         * Returns all sets allocated from the pool. Their DescriptorSet
+         * objects must not be used afterwards.
+         */
+        void reset () const noexcept;
 
     private:
         VkDescriptorPool _native;
         const Device *_device;
+        VkDescriptorPoolCreateFlags _flags;
     };
 }
 
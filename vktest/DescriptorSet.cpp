@@ -2,7 +2,7 @@
 #include <algorithm>
 #include <stdexcept>
 
-vktest::DescriptorSet::DescriptorSet (const DescriptorPool &pool, const DescriptorSetLayout &layout) {
+vktest::DescriptorSet::DescriptorSet (const DescriptorPool &pool, const DescriptorSetLayout &layout) : _pool {&pool} {
     VkDescriptorSetAllocateInfo alloc_info {};
     alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     alloc_info.descriptorPool = pool.get_native();
@@ -21,7 +21,8 @@ vktest::DescriptorSet::DescriptorSet (DescriptorSet &&other) noexcept {
 }
 
 vktest::DescriptorSet::~DescriptorSet () {
-    if (_native != nullptr) {
+    // Sets of pools that cannot free single sets are freed with the pool.
+    if (_native != nullptr && (_pool->get_flags() & VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)) {
         vkFreeDescriptorSets(_pool->get_device().get_native(), _pool->get_native(), 1, &_native);
         _native = nullptr;
     }
@@ -2,10 +2,20 @@
 #include <stdexcept>
 
 vktest::DescriptorSetLayout::DescriptorSetLayout (
-        const Device &device, const std::vector<VkDescriptorSetLayoutBinding> &bindings)
+        const Device &device,
+        const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+        VkDescriptorSetLayoutCreateFlags flags,
+        const std::vector<VkDescriptorBindingFlags> &binding_flags)
         : _device {&device} {
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flags_info {};
+    flags_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    flags_info.bindingCount = static_cast<uint32_t>(binding_flags.size());
+    flags_info.pBindingFlags = binding_flags.data();
+
     VkDescriptorSetLayoutCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    if (!binding_flags.empty()) create_info.pNext = &flags_info;
+    create_info.flags = flags;
     create_info.bindingCount = static_cast<uint32_t>(bindings.size());
     create_info.pBindings = bindings.data();
 
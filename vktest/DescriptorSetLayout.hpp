@@ -9,7 +9,13 @@
 namespace vktest {
     class DescriptorSetLayout {
     public:
-        DescriptorSetLayout (const Device &device, const std::vector<VkDescriptorSetLayoutBinding> &bindings);
+        /**
+         * @param binding_flags Empty, or one entry per binding.
+         */
+        DescriptorSetLayout (const Device &device,
+                             const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                             VkDescriptorSetLayoutCreateFlags flags = 0,
+                             const std::vector<VkDescriptorBindingFlags> &binding_flags = {});
         DescriptorSetLayout (const DescriptorSetLayout &) = delete;
         DescriptorSetLayout (DescriptorSetLayout &&other) noexcept;
         ~DescriptorSetLayout ();
@@ -29,7 +29,7 @@ namespace vktest {
 
 vktest::Device::Device (const PhysicalDevice &physical_device,
                         const std::vector<QueueCreateDesc> &queue_create_descs)
-        : _physical_device {&physical_device}, _queues {} {
+        : _physical_device {&physical_device}, _features {}, _dispatch {}, _queues {} {
     std::vector<VkDeviceQueueCreateInfo> queue_create_infos {};
     for (const QueueCreateDesc &desc : queue_create_descs) {
         VkDeviceQueueCreateInfo queue_create_info {};
@@ -48,23 +48,84 @@ vktest::Device::Device (const PhysicalDevice &physical_device,
     // Enable sample shading
     features.sampleRateShading = VK_TRUE;
 
+    // Optional features for GPU-driven rendering.
+    VkPhysicalDeviceFeatures supported = physical_device.get_features();
+    VkPhysicalDeviceVulkan12Features supported12 = physical_device.get_vulkan12_features();
+    _features.multi_draw_indirect = supported.multiDrawIndirect;
+    _features.draw_indirect_first_instance = supported.drawIndirectFirstInstance;
+    _features.draw_indirect_count = supported12.drawIndirectCount;
+    features.multiDrawIndirect = supported.multiDrawIndirect;
+    features.drawIndirectFirstInstance = supported.drawIndirectFirstInstance;
+    // For generating all mip levels of a texture in one dispatch.
+    _features.storage_image_array_dynamic_indexing = supported.shaderStorageImageArrayDynamicIndexing;
+    features.shaderStorageImageArrayDynamicIndexing = supported.shaderStorageImageArrayDynamicIndexing;
+
+    // Vulkan 1.2 features are enabled by chaining the struct to pNext; only
+    // valid when the device supports Vulkan 1.2.
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    features12.drawIndirectCount = supported12.drawIndirectCount;
+    // Descriptor indexing was promoted from VK_EXT_descriptor_indexing.
+    _features.descriptor_indexing = supported12.shaderSampledImageArrayNonUniformIndexing
+                                 && supported12.runtimeDescriptorArray
+                                 && supported12.descriptorBindingPartiallyBound
+                                 && supported12.descriptorBindingSampledImageUpdateAfterBind
+                                 && supported12.descriptorBindingUpdateUnusedWhilePending;
+    if (_features.descriptor_indexing) {
+        features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        features12.runtimeDescriptorArray = VK_TRUE;
+        features12.descriptorBindingPartiallyBound = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+    }
+    bool has_vulkan12 = physical_device.get_properties().apiVersion >= VK_API_VERSION_1_2;
+    bool has_vulkan13 = physical_device.get_properties().apiVersion >= VK_API_VERSION_1_3;
+
+    // Dynamic rendering is core in Vulkan 1.3, older devices may provide it
+    // through the extension.
+    std::vector<const char*> extensions = device_extensions;
+    VkPhysicalDeviceDynamicRenderingFeatures rendering_features = physical_device.get_dynamic_rendering_features();
+    _features.dynamic_rendering = rendering_features.dynamicRendering;
+    if (_features.dynamic_rendering && !has_vulkan13) extensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+    // So is synchronization2, which lets every barrier carry its own stages.
+    VkPhysicalDeviceSynchronization2Features sync2_features = physical_device.get_synchronization2_features();
+    _features.synchronization2 = sync2_features.synchronization2;
+    if (_features.synchronization2 && !has_vulkan13) extensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+    // Push descriptors are only an extension, without a feature struct.
+    _features.push_descriptor = physical_device.supports_extension(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    if (_features.push_descriptor) extensions.push_back(VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+    const void *next = nullptr;
+    if (_features.dynamic_rendering) next = &rendering_features;
+    if (_features.synchronization2) {
+        sync2_features.pNext = const_cast<void*>(next);
+        next = &sync2_features;
+    }
+    if (has_vulkan12) {
+        features12.pNext = const_cast<void*>(next);
+        next = &features12;
+    }
+
     VkDeviceCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    create_info.pNext = next;
     create_info.queueCreateInfoCount = 1;
     create_info.pQueueCreateInfos = queue_create_infos.data();
     create_info.pEnabledFeatures = &features;
-    create_info.enabledExtensionCount = static_cast<uint32_t>( device_extensions.size() );
-    create_info.ppEnabledExtensionNames = device_extensions.data();
+    create_info.enabledExtensionCount = static_cast<uint32_t>( extensions.size() );
+    create_info.ppEnabledExtensionNames = extensions.data();
     fill_layers_info(create_info);
 
     VkResult res = vkCreateDevice(physical_device.get_native(), &create_info, nullptr, &_native);
     if (res != VK_SUCCESS) throw std::runtime_error("Failed to create logical device");
     fetch_queues(queue_create_descs);
+    load_functions(has_vulkan13);
 }
 
 vktest::Device::Device (Device &&other) noexcept : _queues {} {
     _native = other._native;
     _physical_device = other._physical_device;
+    _features = other._features;
+    _dispatch = other._dispatch;
     _queues.insert( std::make_move_iterator(other._queues.begin()),
                     std::make_move_iterator(other._queues.end()) );
     other._native = nullptr;
@@ -82,6 +143,14 @@ const vktest::PhysicalDevice &vktest::Device::get_physical_device () const noexc
     return *_physical_device;
 }
 
+const vktest::DeviceFeatures &vktest::Device::get_features () const noexcept {
+    return _features;
+}
+
+const vktest::DeviceDispatch &vktest::Device::get_dispatch () const noexcept {
+    return _dispatch;
+}
+
 vktest::Queue &vktest::Device::get_queue (uint32_t queue_family_index, uint32_t queue_index) {
     std::pair<uint32_t,uint32_t> key = std::make_pair(queue_family_index, queue_index);
     auto it = _queues.find(key);
@@ -117,3 +186,21 @@ void vktest::Device::fetch_queues (const std::vector<QueueCreateDesc> &queue_cre
         }
     }
 }
+
+void vktest::Device::load_functions (bool has_vulkan13) noexcept {
+    // Core functions have no suffix, the extension ones keep theirs.
+    if (_features.dynamic_rendering) {
+        _dispatch.cmd_begin_rendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+                vkGetDeviceProcAddr(_native, has_vulkan13 ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+        _dispatch.cmd_end_rendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+                vkGetDeviceProcAddr(_native, has_vulkan13 ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+    }
+    if (_features.synchronization2) {
+        _dispatch.cmd_pipeline_barrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+                vkGetDeviceProcAddr(_native, has_vulkan13 ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR"));
+    }
+    if (_features.push_descriptor) {
+        _dispatch.cmd_push_descriptor_set = reinterpret_cast<PFN_vkCmdPushDescriptorSetKHR>(
+                vkGetDeviceProcAddr(_native, "vkCmdPushDescriptorSetKHR"));
+    }
+}
@@ -30,6 +30,45 @@ namespace vktest {
         std::vector<float> priorities;
     };
 
+    /**
+     * Optional features. Each one is enabled when the physical device
+     * supports it, and the application picks its code paths accordingly.
+     */
+    struct DeviceFeatures {
+        bool multi_draw_indirect = false;
+        bool draw_indirect_first_instance = false;
+        bool draw_indirect_count = false;
+        bool dynamic_rendering = false;
+        bool synchronization2 = false;
+        /**
+         * Non-uniformly indexed, partially bound arrays of sampled images
+         * that can be updated after they are bound.
+         */
+        bool descriptor_indexing = false;
+        /**
+         * Descriptors written into the command buffer instead of a set
+         * (VK_KHR_push_descriptor).
+         */
+        bool push_descriptor = false;
+        /**
+         * Arrays of storage images indexed with dynamically uniform
+         * expressions.
+         */
+        bool storage_image_array_dynamic_indexing = false;
+    };
+
+    /**
+     * Device-level entry points that the loader does not export, because
+     * they come from an extension or a newer Vulkan version. Null when the
+     * matching feature is not enabled.
+     */
+    struct DeviceDispatch {
+        PFN_vkCmdBeginRenderingKHR cmd_begin_rendering = nullptr;
+        PFN_vkCmdEndRenderingKHR cmd_end_rendering = nullptr;
+        PFN_vkCmdPipelineBarrier2KHR cmd_pipeline_barrier2 = nullptr;
+        PFN_vkCmdPushDescriptorSetKHR cmd_push_descriptor_set = nullptr;
+    };
+
     /**
      * A logical device
      */
@@ -41,6 +80,8 @@ namespace vktest {
         ~Device ();
         VkDevice get_native () const noexcept;
         const PhysicalDevice &get_physical_device () const noexcept;
+        const DeviceFeatures &get_features () const noexcept;
+        const DeviceDispatch &get_dispatch () const noexcept;
         Queue &get_queue (uint32_t queue_family_index, uint32_t queue_index);
         void wait_idle () const noexcept;
         void wait_for_fences (const std::vector<const Fence*> fences, bool wait_all, uint64_t timeout) const noexcept;
@@ -48,6 +89,7 @@ namespace vktest {
 
     private:
         void fetch_queues (const std::vector<QueueCreateDesc> &queue_create_descs) noexcept;
+        void load_functions (bool has_vulkan13) noexcept;
 
         /**
          * NOTE: VkDevice objects *can* be destroyed when all VkQueue objects
@@ -56,6 +98,8 @@ namespace vktest {
          */
         VkDevice _native;
         const PhysicalDevice *_physical_device;
+        DeviceFeatures _features;
+        DeviceDispatch _dispatch;
         std::map<std::pair<uint32_t,uint32_t>,std::unique_ptr<Queue>> _queues;
     };
 }
@@ -26,11 +26,17 @@ VkDeviceMemory vktest::DeviceMemory::get_native () const noexcept {
 }
 
 void *vktest::DeviceMemory::map (VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags) const noexcept {
-    void *data;
+    void *data = nullptr;
     VkResult res = vkMapMemory(_device->get_native(), _native, offset, size, flags, &data);
-    return data;
+    return res == VK_SUCCESS ? data : nullptr;
 }
 
 void vktest::DeviceMemory::unmap () const noexcept {
     vkUnmapMemory(_device->get_native(), _native);
 }
+
+VkDeviceSize vktest::DeviceMemory::get_commitment () const noexcept {
+    VkDeviceSize committed = 0;
+    vkGetDeviceMemoryCommitment(_device->get_native(), _native, &committed);
+    return committed;
+}
@@ -16,10 +16,15 @@ namespace vktest {
         ~DeviceMemory ();
         VkDeviceMemory get_native () const noexcept;
         /**
-         * @return data
+         * @return data, or nullptr if the memory could not be mapped
          */
         void *map (VkDeviceSize offset, VkDeviceSize size, VkMemoryMapFlags flags = 0) const noexcept;
         void unmap () const noexcept;
+        /**
+         * The bytes the implementation has actually backed. It is less than
+         * the allocation size only for lazily allocated memory.
+         */
+        VkDeviceSize get_commitment () const noexcept;
 
     private:
         VkDeviceMemory _native;
@@ -1,12 +1,35 @@
 #include "Image.hpp"
 #include <stdexcept>
 
-vktest::Image::Image (const Device &device, const VkImageCreateInfo &info) : _device {&device} {
+namespace vktest {
+    static VkImageAspectFlags get_aspect_mask (VkFormat format) noexcept {
+        switch (format) {
+        case VK_FORMAT_D16_UNORM:
+        case VK_FORMAT_X8_D24_UNORM_PACK32:
+        case VK_FORMAT_D32_SFLOAT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT;
+        case VK_FORMAT_S8_UINT:
+            return VK_IMAGE_ASPECT_STENCIL_BIT;
+        case VK_FORMAT_D16_UNORM_S8_UINT:
+        case VK_FORMAT_D24_UNORM_S8_UINT:
+        case VK_FORMAT_D32_SFLOAT_S8_UINT:
+            return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        default:
+            return VK_IMAGE_ASPECT_COLOR_BIT;
+        }
+    }
+}
+
+vktest::Image::Image (const Device &device, const VkImageCreateInfo &info)
+        : _device {&device},
+          _state {get_aspect_mask(info.format), info.mipLevels, info.arrayLayers} {
     VkResult res = vkCreateImage(device.get_native(), &info, nullptr, &_native);
     if (res != VK_SUCCESS) throw std::runtime_error("Failed to create image");
+    // VK_IMAGE_LAYOUT_UNDEFINED or VK_IMAGE_LAYOUT_PREINITIALIZED.
+    _state.assume(_state.get_full_range(), ImageAccess { info.initialLayout, 0, 0 });
 }
 
-vktest::Image::Image (Image &&other) noexcept {
+vktest::Image::Image (Image &&other) noexcept : _state {std::move(other._state)} {
     _native = other._native;
     _device = other._device;
     other._native = nullptr;
@@ -30,6 +53,10 @@ void vktest::Image::bind_memory (const DeviceMemory &memory, VkDeviceSize memory
     vkBindImageMemory(_device->get_native(), _native, memory.get_native(), memory_offset);
 }
 
+vktest::ImageState &vktest::Image::get_state () const noexcept {
+    return _state;
+}
+
 vktest::Image::Image (const Device &device, VkImage native) noexcept
-        : _native {native}, _device {&device} {
+        : _native {native}, _device {&device}, _state {VK_IMAGE_ASPECT_COLOR_BIT, 1, 1} {
 }
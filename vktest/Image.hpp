@@ -4,6 +4,7 @@
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 #include "Device.hpp"
+#include "ImageState.hpp"
 
 namespace vktest {
     class Image {
@@ -15,12 +16,19 @@ namespace vktest {
         VkImage get_native () const noexcept;
         VkMemoryRequirements get_memory_requirements () const noexcept;
         void bind_memory (const DeviceMemory &memory, VkDeviceSize memory_offset) const noexcept;
+        /**
+         * The layout and last access of each subresource, as recorded into
+         * command buffers so far. Updated through the command buffers, which
+         * only hold the image as const.
+         */
+        ImageState &get_state () const noexcept;
 
     private:
         Image (const Device &device, VkImage native) noexcept;
 
         VkImage _native;
         const Device *_device;
+        mutable ImageState _state;
     };
 }
 
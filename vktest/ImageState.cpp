@@ -0,0 +1,140 @@
+#include "ImageState.hpp"
+#include <optional>
+
+namespace vktest {
+    // Accesses that make the following accesses depend on them. Two reads in
+    // the same layout can happen in any order.
+    static const VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT
+                                            | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+                                            | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT
+                                            | VK_ACCESS_TRANSFER_WRITE_BIT
+                                            | VK_ACCESS_HOST_WRITE_BIT
+                                            | VK_ACCESS_MEMORY_WRITE_BIT;
+}
+
+vktest::ImageState::ImageState (VkImageAspectFlags aspect_mask, uint32_t mip_levels, uint32_t array_layers)
+        : _aspect_mask {aspect_mask},
+          _mip_levels {mip_levels},
+          _array_layers {array_layers},
+          _subresources (static_cast<size_t>(mip_levels) * array_layers) {
+}
+
+VkImageAspectFlags vktest::ImageState::get_aspect_mask () const noexcept {
+    return _aspect_mask;
+}
+
+VkImageSubresourceRange vktest::ImageState::get_full_range () const noexcept {
+    return VkImageSubresourceRange { _aspect_mask, 0, _mip_levels, 0, _array_layers };
+}
+
+VkImageLayout vktest::ImageState::get_layout (uint32_t mip_level, uint32_t array_layer) const noexcept {
+    return _subresources[index(mip_level, array_layer)].layout;
+}
+
+void vktest::ImageState::transition (VkImage image,
+                                     const VkImageSubresourceRange &range,
+                                     const ImageAccess &next,
+                                     bool discard,
+                                     std::vector<VkImageMemoryBarrier2> &barriers) noexcept {
+    VkImageSubresourceRange resolved = resolve(range);
+    for (uint32_t layer = resolved.baseArrayLayer; layer < resolved.baseArrayLayer + resolved.layerCount; layer++) {
+        // The barrier of the previous level, if it can be extended.
+        std::optional<size_t> last {};
+        for (uint32_t level = resolved.baseMipLevel; level < resolved.baseMipLevel + resolved.levelCount; level++) {
+            Subresource &current = _subresources[index(level, layer)];
+            bool same_layout = current.layout == next.layout;
+            bool before_write = (next.access & WRITE_ACCESS) != 0;
+            VkImageMemoryBarrier2 barrier {};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+            if (same_layout && !before_write) {
+                // Read after write: the write is made visible to the new
+                // reads, and to the earlier ones again so that the reads that
+                // are covered stay a plain union of stages and access.
+                bool covered = (next.stages & ~current.read_stages) == 0
+                            && (next.access & ~current.read_access) == 0;
+                if (current.write_stages == 0 || covered) {
+                    // Only remembered, so a later write waits for all of
+                    // the reads.
+                    current.read_stages |= next.stages;
+                    current.read_access |= next.access;
+                    last.reset();
+                    continue;
+                }
+                barrier.srcStageMask = current.write_stages;
+                barrier.srcAccessMask = current.write_access;
+                barrier.dstStageMask = current.read_stages | next.stages;
+                barrier.dstAccessMask = current.read_access | next.access;
+                barrier.oldLayout = current.layout;
+                current.read_stages = barrier.dstStageMask;
+                current.read_access = barrier.dstAccessMask;
+            } else {
+                // Write after anything, or a layout transition: wait for the
+                // write and every read of it. Only the write has to be made
+                // available, reads only need the execution dependency.
+                VkPipelineStageFlags src_stages = current.write_stages | current.read_stages;
+                // Nothing to wait for before the first access.
+                barrier.srcStageMask = src_stages != 0
+                        ? src_stages : static_cast<VkPipelineStageFlags>(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+                barrier.srcAccessMask = current.write_access;
+                barrier.dstStageMask = next.stages;
+                barrier.dstAccessMask = next.access;
+                barrier.oldLayout = discard ? VK_IMAGE_LAYOUT_UNDEFINED : current.layout;
+                record(current, next);
+            }
+
+            if (last && barriers[*last].oldLayout == barrier.oldLayout
+                     && barriers[*last].srcStageMask == barrier.srcStageMask
+                     && barriers[*last].srcAccessMask == barrier.srcAccessMask
+                     && barriers[*last].dstStageMask == barrier.dstStageMask
+                     && barriers[*last].dstAccessMask == barrier.dstAccessMask) {
+                barriers[*last].subresourceRange.levelCount++;
+            } else {
+                barrier.newLayout = next.layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = image;
+                barrier.subresourceRange = { resolved.aspectMask, level, 1, layer, 1 };
+                barriers.push_back(barrier);
+                last = barriers.size() - 1;
+            }
+        }
+    }
+}
+
+void vktest::ImageState::assume (const VkImageSubresourceRange &range, const ImageAccess &access) noexcept {
+    VkImageSubresourceRange resolved = resolve(range);
+    for (uint32_t layer = resolved.baseArrayLayer; layer < resolved.baseArrayLayer + resolved.layerCount; layer++) {
+        for (uint32_t level = resolved.baseMipLevel; level < resolved.baseMipLevel + resolved.levelCount; level++) {
+            record(_subresources[index(level, layer)], access);
+        }
+    }
+}
+
+void vktest::ImageState::record (Subresource &subresource, const ImageAccess &access) noexcept {
+    subresource.layout = access.layout;
+    if ((access.access & WRITE_ACCESS) != 0) {
+        subresource.write_stages = access.stages;
+        subresource.write_access = access.access & WRITE_ACCESS;
+        subresource.read_stages = 0;
+        subresource.read_access = 0;
+    } else {
+        // Reached through a barrier that happened after the last write, so
+        // later accesses wait for that barrier through these stages. The
+        // write is already available and only has to be made visible.
+        subresource.write_stages = access.stages;
+        subresource.write_access = 0;
+        subresource.read_stages = access.stages;
+        subresource.read_access = access.access;
+    }
+}
+
+size_t vktest::ImageState::index (uint32_t mip_level, uint32_t array_layer) const noexcept {
+    return static_cast<size_t>(array_layer) * _mip_levels + mip_level;
+}
+
+VkImageSubresourceRange vktest::ImageState::resolve (const VkImageSubresourceRange &range) const noexcept {
+    VkImageSubresourceRange resolved = range;
+    if (resolved.levelCount == VK_REMAINING_MIP_LEVELS) resolved.levelCount = _mip_levels - resolved.baseMipLevel;
+    if (resolved.layerCount == VK_REMAINING_ARRAY_LAYERS) resolved.layerCount = _array_layers - resolved.baseArrayLayer;
+    return resolved;
+}
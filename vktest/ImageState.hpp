@@ -0,0 +1,80 @@
+#ifndef __VKTEST_IMAGESTATE_HPP__
+#define __VKTEST_IMAGESTATE_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+
+namespace vktest {
+    /**
+     * How a subresource of an image is accessed: in which layout, by which
+     * pipeline stages and with which kinds of access.
+     */
+    struct ImageAccess {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+
+    /**
+     * Tracks the last access of every mip level and array layer of an image,
+     * in the order the commands are recorded. It is only accurate as long as
+     * command buffers are submitted in the order they were recorded in.
+     */
+    class ImageState {
+    public:
+        ImageState (VkImageAspectFlags aspect_mask, uint32_t mip_levels, uint32_t array_layers);
+        VkImageAspectFlags get_aspect_mask () const noexcept;
+        /**
+         * @return The range of all subresources of the image.
+         */
+        VkImageSubresourceRange get_full_range () const noexcept;
+        VkImageLayout get_layout (uint32_t mip_level, uint32_t array_layer) const noexcept;
+        /**
+         * Records that *range* is accessed as *next* from now on, and appends
+         * the barriers needed before that access to *barriers*. A read in the
+         * same layout needs no barrier if an earlier barrier already made the
+         * last write visible to its stages and access. Subresources with the
+         * same previous state are covered by a single barrier, which waits on
+         * the stages of that state only.
+         *
+         * @param discard The previous contents are not needed, so layout
+         * transitions start from VK_IMAGE_LAYOUT_UNDEFINED.
+         */
+        void transition (VkImage image,
+                         const VkImageSubresourceRange &range,
+                         const ImageAccess &next,
+                         bool discard,
+                         std::vector<VkImageMemoryBarrier2> &barriers) noexcept;
+        /**
+         * Records an access that was synchronized elsewhere, such as the
+         * final layout a render pass leaves its attachments in.
+         */
+        void assume (const VkImageSubresourceRange &range, const ImageAccess &access) noexcept;
+
+    private:
+        /**
+         * The last write of a subresource and the reads that were made to
+         * wait for it since. A layout transition counts as a write in the
+         * stages it was made to happen before.
+         */
+        struct Subresource {
+            VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            VkPipelineStageFlags write_stages = 0;
+            VkAccessFlags write_access = 0;
+            VkPipelineStageFlags read_stages = 0;
+            VkAccessFlags read_access = 0;
+        };
+
+        static void record (Subresource &subresource, const ImageAccess &access) noexcept;
+        size_t index (uint32_t mip_level, uint32_t array_layer) const noexcept;
+        VkImageSubresourceRange resolve (const VkImageSubresourceRange &range) const noexcept;
+
+        VkImageAspectFlags _aspect_mask;
+        uint32_t _mip_levels;
+        uint32_t _array_layers;
+        std::vector<Subresource> _subresources;
+    };
+}
+
+#endif /* __VKTEST_IMAGESTATE_HPP__ */
@@ -5,7 +5,8 @@ vktest::ImageView::ImageView (const Device &device,
                               VkImage image,
                               VkFormat format,
                               VkImageAspectFlags aspect_flags,
-                              uint32_t mip_levels) : _device {&device} {
+                              uint32_t mip_levels,
+                              uint32_t base_mip_level) : _device {&device} {
     VkImageViewCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
     create_info.image = image;
@@ -21,7 +22,7 @@ vktest::ImageView::ImageView (const Device &device,
     // The subresourceRange field describes what the image's purpose is and
     // which part of the image should be accessed.
     create_info.subresourceRange.aspectMask = aspect_flags;
-    create_info.subresourceRange.baseMipLevel = 0;
+    create_info.subresourceRange.baseMipLevel = base_mip_level;
     create_info.subresourceRange.levelCount = mip_levels;
     create_info.subresourceRange.baseArrayLayer = 0;
     create_info.subresourceRange.layerCount = 1;
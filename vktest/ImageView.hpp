@@ -12,7 +12,8 @@ namespace vktest {
                    VkImage image,
                    VkFormat format,
                    VkImageAspectFlags aspect_flags,
-                   uint32_t mip_levels);
+                   uint32_t mip_levels,
+                   uint32_t base_mip_level = 0);
         ImageView (const ImageView &) = delete;
         ImageView (ImageView &&other) noexcept;
         ~ImageView ();
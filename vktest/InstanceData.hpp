@@ -0,0 +1,56 @@
+#ifndef __VKTEST_INSTANCEDATA_HPP__
+#define __VKTEST_INSTANCEDATA_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace vktest {
+    /**
+     * Per-instance data, fetched once per instance from binding 2. The same
+     * array is read as a storage buffer by the culling compute shader.
+     */
+    struct InstanceData {
+        glm::mat4 model;
+        /**
+         * Object space bounding sphere: center in xyz, radius in w.
+         */
+        glm::vec4 bounds;
+        /**
+         * Index of the texture in the bindless texture array.
+         */
+        uint32_t material;
+        // std430 rounds the size of the struct up to 16 bytes.
+        uint32_t padding[3];
+
+        static std::vector<VkVertexInputBindingDescription> get_binding_descs () {
+            std::vector<VkVertexInputBindingDescription> binding_descs (1);
+            binding_descs[0].binding = 2;
+            binding_descs[0].stride = sizeof(InstanceData);
+            // Move to the next data entry after each instance.
+            binding_descs[0].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+            return binding_descs;
+        }
+
+        static std::vector<VkVertexInputAttributeDescription> get_attribute_descs () {
+            // A mat4 input occupies four consecutive locations, one per column.
+            std::vector<VkVertexInputAttributeDescription> attribute_descs (5);
+            for (uint32_t i = 0; i < 4; i++) {
+                attribute_descs[i].binding = 2;
+                attribute_descs[i].location = 3 + i;
+                attribute_descs[i].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+                attribute_descs[i].offset = offsetof(InstanceData, model) + sizeof(glm::vec4) * i;
+            }
+            attribute_descs[4].binding = 2;
+            attribute_descs[4].location = 7;
+            attribute_descs[4].format = VK_FORMAT_R32_UINT;
+            attribute_descs[4].offset = offsetof(InstanceData, material);
+            return attribute_descs;
+        }
+    };
+}
+
+#endif /* __VKTEST_INSTANCEDATA_HPP__ */
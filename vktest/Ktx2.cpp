@@ -0,0 +1,251 @@
+#include "Ktx2.hpp"
+#include "BlockCompression.hpp"
+#include "MipGeneration.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace vktest {
+    static const unsigned char KTX2_IDENTIFIER[12] {
+        0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A
+    };
+
+    // The identifier, the header and the index, followed by the level index.
+    static const size_t KTX2_LEVEL_INDEX_OFFSET = 80;
+    static const size_t KTX2_LEVEL_INDEX_ENTRY_SIZE = 24;
+
+    // Khronos Data Format values used by the descriptors below.
+    static const uint32_t KHR_DF_MODEL_RGBSDA = 1;
+    static const uint32_t KHR_DF_MODEL_BC1A = 128;
+    static const uint32_t KHR_DF_MODEL_BC3 = 130;
+    static const uint32_t KHR_DF_CHANNEL_ALPHA = 15;
+    static const uint32_t KHR_DF_SAMPLE_DATATYPE_LINEAR = 0x10;
+
+    struct DfdSample {
+        uint32_t bit_offset;
+        uint32_t bit_length;
+        uint32_t channel;
+        uint32_t upper;
+    };
+
+    // The basic data format descriptor of *format*: the total size, the
+    // block header and one sample per channel or part of a compressed block.
+    static std::vector<uint32_t> make_dfd (VkFormat format) {
+        uint32_t model, block_dimension;
+        std::vector<DfdSample> samples;
+        switch (format) {
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+                model = KHR_DF_MODEL_RGBSDA;
+                block_dimension = 0;
+                samples = { { 0, 7, 0, 255 }, { 8, 7, 1, 255 }, { 16, 7, 2, 255 },
+                            { 24, 7, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_DATATYPE_LINEAR, 255 } };
+                break;
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+                model = KHR_DF_MODEL_BC1A;
+                block_dimension = 3 | 3 << 8;
+                samples = { { 0, 63, 0, UINT32_MAX } };
+                break;
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+                model = KHR_DF_MODEL_BC1A;
+                block_dimension = 3 | 3 << 8;
+                samples = { { 0, 63, KHR_DF_CHANNEL_ALPHA, UINT32_MAX } };
+                break;
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                model = KHR_DF_MODEL_BC3;
+                block_dimension = 3 | 3 << 8;
+                samples = { { 0, 63, KHR_DF_CHANNEL_ALPHA | KHR_DF_SAMPLE_DATATYPE_LINEAR, UINT32_MAX },
+                            { 64, 63, 0, UINT32_MAX } };
+                break;
+            default:
+                throw std::runtime_error("Failed to write KTX2 file, the format is not supported");
+        }
+        bool srgb = get_decompressed_format(format) == VK_FORMAT_R8G8B8A8_SRGB;
+        uint32_t block_size = static_cast<uint32_t>(6 * 4 + samples.size() * 16);
+        std::vector<uint32_t> dfd {
+            4 + block_size,
+            0, // vendorId, descriptorType
+            block_size << 16 | 2, // descriptorBlockSize, versionNumber
+            // BT.709 primaries, straight alpha.
+            model | 1 << 8 | (srgb ? 2u : 1u) << 16,
+            block_dimension,
+            static_cast<uint32_t>(get_block_size(format)), // bytesPlane0
+            0
+        };
+        for (const DfdSample &sample : samples) {
+            dfd.insert(dfd.end(), { sample.bit_offset | sample.bit_length << 16 | sample.channel << 24,
+                                    0, 0, sample.upper });
+        }
+        return dfd;
+    }
+
+    // The formats the texture loader can upload. BC7 and ETC2 have no
+    // decoder to fall back on where the device cannot sample them.
+    static bool is_supported_format (VkFormat format) noexcept {
+        switch (format) {
+            case VK_FORMAT_BC7_SRGB_BLOCK:
+            case VK_FORMAT_BC7_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
+            case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
+            case VK_FORMAT_R8G8B8A8_SRGB:
+            case VK_FORMAT_R8G8B8A8_UNORM:
+            case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+            case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+            case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+            case VK_FORMAT_BC3_SRGB_BLOCK:
+            case VK_FORMAT_BC3_UNORM_BLOCK:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    template <typename T>
+    static T read_value (const std::vector<unsigned char> &header, size_t offset) {
+        if (offset + sizeof(T) > header.size()) throw std::runtime_error("Failed to parse KTX2 file, it is truncated");
+        T value;
+        std::memcpy(&value, header.data() + offset, sizeof(T));
+        return value;
+    }
+
+    // Appends the next *size* bytes of *file* to *header*.
+    static void read_bytes (std::istream &file, std::vector<unsigned char> &header, size_t size) {
+        size_t offset = header.size();
+        header.resize(offset + size);
+        file.read(reinterpret_cast<char*>(header.data() + offset), static_cast<std::streamsize>(size));
+        if (!file) throw std::runtime_error("Failed to parse KTX2 file, it is truncated");
+    }
+
+    template <typename T>
+    static void write_value (std::vector<unsigned char> &file, size_t offset, T value) {
+        std::memcpy(file.data() + offset, &value, sizeof(T));
+    }
+
+    static size_t align_up (size_t value, size_t alignment) noexcept {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+}
+
+bool vktest::is_ktx2 (std::istream &file) {
+    std::istream::pos_type position = file.tellg();
+    char identifier[sizeof(KTX2_IDENTIFIER)] {};
+    file.read(identifier, sizeof(identifier));
+    bool match = file && std::memcmp(identifier, KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER)) == 0;
+    file.clear();
+    file.seekg(position);
+    return match;
+}
+
+vktest::Ktx2Image vktest::read_ktx2 (std::istream &file) {
+    if (!is_ktx2(file)) throw std::runtime_error("Failed to parse KTX2 file, the identifier does not match");
+    // The levels are checked against the size of the file without reading
+    // them.
+    std::istream::pos_type start = file.tellg();
+    file.seekg(0, std::ios::end);
+    size_t file_size = static_cast<size_t>(file.tellg() - start);
+    file.seekg(start);
+
+    std::vector<unsigned char> header {};
+    read_bytes(file, header, KTX2_LEVEL_INDEX_OFFSET);
+    Ktx2Image image {};
+    image.format = static_cast<VkFormat>(read_value<uint32_t>(header, 12));
+    image.width = read_value<uint32_t>(header, 20);
+    image.height = read_value<uint32_t>(header, 24);
+    uint32_t depth = read_value<uint32_t>(header, 28);
+    uint32_t layer_count = read_value<uint32_t>(header, 32);
+    uint32_t face_count = read_value<uint32_t>(header, 36);
+    uint32_t level_count = read_value<uint32_t>(header, 40);
+    uint32_t supercompression = read_value<uint32_t>(header, 44);
+
+    // VK_FORMAT_UNDEFINED is used for Basis Universal data, which would have
+    // to be transcoded first.
+    if (image.format == VK_FORMAT_UNDEFINED || supercompression != 0) {
+        throw std::runtime_error("Failed to parse KTX2 file, supercompressed data is not supported");
+    }
+    if (!is_supported_format(image.format)) {
+        throw std::runtime_error("Failed to parse KTX2 file, the format is not supported");
+    }
+    if (image.width == 0 || image.height == 0 || depth > 1 || layer_count > 1 || face_count != 1) {
+        throw std::runtime_error("Failed to parse KTX2 file, only single 2D images are supported");
+    }
+    // 0 asks the loader to generate the mip levels; the file holds the base
+    // level only.
+    level_count = std::max(level_count, 1u);
+    if (level_count > get_mip_level_count(image.width, image.height)) {
+        throw std::runtime_error("Failed to parse KTX2 file, there are more mip levels than the image has");
+    }
+    read_bytes(file, header, level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE);
+
+    image.levels.reserve(level_count);
+    for (uint32_t i = 0; i < level_count; i++) {
+        size_t entry = KTX2_LEVEL_INDEX_OFFSET + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        uint64_t offset = read_value<uint64_t>(header, entry);
+        uint64_t size = read_value<uint64_t>(header, entry + 8);
+        // Written this way so that offset + size cannot overflow.
+        if (offset > file_size || size > file_size - offset) {
+            throw std::runtime_error("Failed to parse KTX2 file, a mip level is out of bounds");
+        }
+        uint32_t width = std::max(image.width >> i, 1u), height = std::max(image.height >> i, 1u);
+        if (size != get_level_size(image.format, width, height)) {
+            throw std::runtime_error("Failed to parse KTX2 file, a mip level has the wrong size");
+        }
+        image.levels.push_back({ static_cast<size_t>(offset), static_cast<size_t>(size) });
+    }
+    return image;
+}
+
+std::vector<unsigned char> vktest::write_ktx2 (VkFormat format,
+                                               uint32_t width,
+                                               uint32_t height,
+                                               const std::vector<std::vector<unsigned char>> &levels) {
+    std::vector<uint32_t> dfd = make_dfd(format);
+    size_t dfd_size = dfd.size() * sizeof(uint32_t);
+    uint32_t level_count = static_cast<uint32_t>(levels.size());
+    size_t dfd_offset = KTX2_LEVEL_INDEX_OFFSET + level_count * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+    // Levels start at multiples of both the block size and 4.
+    size_t alignment = std::max(get_block_size(format), size_t(4));
+
+    // The smallest level comes first in the file, so that a partial file
+    // already holds a usable mip tail.
+    size_t size = dfd_offset + dfd_size;
+    std::vector<size_t> level_offsets (level_count);
+    for (size_t i = level_count; i-- > 0; ) {
+        size = align_up(size, alignment);
+        level_offsets[i] = size;
+        size += levels[i].size();
+    }
+    std::vector<unsigned char> file (size, 0);
+
+    std::memcpy(file.data(), KTX2_IDENTIFIER, sizeof(KTX2_IDENTIFIER));
+    write_value<uint32_t>(file, 12, format);
+    // typeSize is 1 for block compressed formats as well.
+    write_value<uint32_t>(file, 16, 1);
+    write_value<uint32_t>(file, 20, width);
+    write_value<uint32_t>(file, 24, height);
+    write_value<uint32_t>(file, 28, 0); // pixelDepth
+    write_value<uint32_t>(file, 32, 0); // layerCount
+    write_value<uint32_t>(file, 36, 1); // faceCount
+    write_value<uint32_t>(file, 40, level_count);
+    write_value<uint32_t>(file, 44, 0); // supercompressionScheme
+    write_value<uint32_t>(file, 48, static_cast<uint32_t>(dfd_offset));
+    write_value<uint32_t>(file, 52, static_cast<uint32_t>(dfd_size));
+    // No key/value data and no supercompression global data.
+
+    for (uint32_t i = 0; i < level_count; i++) {
+        size_t entry = KTX2_LEVEL_INDEX_OFFSET + i * KTX2_LEVEL_INDEX_ENTRY_SIZE;
+        write_value<uint64_t>(file, entry, level_offsets[i]);
+        write_value<uint64_t>(file, entry + 8, levels[i].size());
+        write_value<uint64_t>(file, entry + 16, levels[i].size());
+        std::memcpy(file.data() + level_offsets[i], levels[i].data(), levels[i].size());
+    }
+    std::memcpy(file.data() + dfd_offset, dfd.data(), dfd_size);
+    return file;
+}
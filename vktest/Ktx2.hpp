@@ -0,0 +1,54 @@
+#ifndef __VKTEST_KTX2_HPP__
+#define __VKTEST_KTX2_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstddef>
+#include <istream>
+#include <vector>
+
+namespace vktest {
+    struct Ktx2Level {
+        // Into the file, aligned to the texel block size.
+        size_t offset;
+        size_t size;
+    };
+
+    /**
+     * The layout of a KTX 2.0 file. Only single 2D images without
+     * supercompression are supported, with any number of mip levels.
+     */
+    struct Ktx2Image {
+        VkFormat format;
+        uint32_t width;
+        uint32_t height;
+        // The base level first.
+        std::vector<Ktx2Level> levels;
+    };
+
+    /**
+     * Whether *file* starts with the KTX2 identifier. The read position is
+     * restored.
+     */
+    bool is_ktx2 (std::istream &file);
+    /**
+     * Reads the header and the level index only, so that the levels can be
+     * read from *file* straight to where they are uploaded from. The
+     * format, the number of mip levels and the size of every level are
+     * checked against what the loader supports and the image size.
+     */
+    Ktx2Image read_ktx2 (std::istream &file);
+    /**
+     * Supports the 8-bit RGBA formats and the block compressed formats of
+     * BlockCompression.hpp.
+     *
+     * @param levels The mip levels, the base level first, each tightly
+     * packed.
+     */
+    std::vector<unsigned char> write_ktx2 (VkFormat format,
+                                           uint32_t width,
+                                           uint32_t height,
+                                           const std::vector<std::vector<unsigned char>> &levels);
+}
+
+#endif /* __VKTEST_KTX2_HPP__ */
@@ -0,0 +1,179 @@
+#include "Mesh.hpp"
+#include <algorithm>
+#include <cmath>
+
+vktest::BoundingSphere vktest::compute_bounding_sphere (const std::vector<glm::vec3> &positions) noexcept {
+    if (positions.empty()) return { glm::vec3(0.0f), 0.0f };
+
+    // The center of the axis aligned bounding box is not the tightest center,
+    // but close enough for LOD selection and culling.
+    glm::vec3 min = positions[0];
+    glm::vec3 max = positions[0];
+    for (const glm::vec3 &p : positions) {
+        min = glm::min(min, p);
+        max = glm::max(max, p);
+    }
+    glm::vec3 center = (min + max) * 0.5f;
+
+    float radius = 0.0f;
+    for (const glm::vec3 &p : positions) {
+        radius = std::max(radius, glm::length(p - center));
+    }
+    return { center, radius };
+}
+
+namespace vktest {
+    static void compute_meshlet_bounds (const std::vector<glm::vec3> &positions,
+                                        const std::vector<uint32_t> &indices,
+                                        Meshlet &meshlet) {
+        std::vector<glm::vec3> points {};
+        points.reserve(meshlet.index_count);
+        glm::vec3 normal_sum (0.0f);
+        std::vector<glm::vec3> normals {};
+        for (uint32_t i = meshlet.first_index; i < meshlet.first_index + meshlet.index_count; i += 3) {
+            const glm::vec3 &p0 = positions[ indices[i] ];
+            const glm::vec3 &p1 = positions[ indices[i + 1] ];
+            const glm::vec3 &p2 = positions[ indices[i + 2] ];
+            points.push_back(p0);
+            points.push_back(p1);
+            points.push_back(p2);
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float length = glm::length(n);
+            if (length > 0.0f) {
+                normals.push_back(n / length);
+                normal_sum += n / length;
+            }
+        }
+        meshlet.bounds = compute_bounding_sphere(points);
+
+        // The cone spans every triangle normal. When it is wider than a
+        // hemisphere there is always a direction that sees a front face.
+        meshlet.cone_axis = glm::vec3(0.0f, 0.0f, 1.0f);
+        meshlet.cone_cutoff = 1.0f;
+        float axis_length = glm::length(normal_sum);
+        if (normals.empty() || axis_length == 0.0f) return;
+        glm::vec3 axis = normal_sum / axis_length;
+        float min_dot = 1.0f;
+        for (const glm::vec3 &n : normals) min_dot = std::min(min_dot, glm::dot(axis, n));
+        if (min_dot <= 0.0f) return;
+        meshlet.cone_axis = axis;
+        // The back-face region is the cone widened by 90 degrees: sin(a).
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
+
+std::vector<vktest::Meshlet> vktest::build_meshlets (const std::vector<glm::vec3> &positions,
+                                                     std::vector<uint32_t> &indices,
+                                                     uint32_t first_index,
+                                                     uint32_t index_count,
+                                                     uint32_t max_vertices,
+                                                     uint32_t max_triangles) {
+    uint32_t triangle_count = index_count / 3;
+    const uint32_t *tris = &indices[first_index];
+
+    // Triangles adjacent to each vertex.
+    std::vector<uint32_t> offsets (positions.size() + 1, 0);
+    for (uint32_t i = 0; i < triangle_count * 3; i++) offsets[ tris[i] + 1 ]++;
+    for (size_t i = 0; i < positions.size(); i++) offsets[i + 1] += offsets[i];
+    std::vector<uint32_t> adjacency (triangle_count * 3);
+    std::vector<uint32_t> fill (offsets.begin(), offsets.end() - 1);
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        for (uint32_t k = 0; k < 3; k++) adjacency[ fill[ tris[t * 3 + k] ]++ ] = t;
+    }
+
+    std::vector<bool> emitted (triangle_count, false);
+    // The meshlet that last used a vertex, offset by one.
+    std::vector<uint32_t> vertex_owner (positions.size(), 0);
+    std::vector<uint32_t> meshlet_vertices {};
+    std::vector<uint32_t> reordered {};
+    reordered.reserve(triangle_count * 3);
+    std::vector<Meshlet> meshlets {};
+    uint32_t next_seed = 0;
+
+    while (reordered.size() < triangle_count * 3) {
+        uint32_t id = static_cast<uint32_t>(meshlets.size()) + 1;
+        Meshlet meshlet {};
+        meshlet.first_index = first_index + static_cast<uint32_t>(reordered.size());
+        meshlet_vertices.clear();
+
+        auto new_vertices = [&](uint32_t t) {
+            uint32_t count = 0;
+            for (uint32_t k = 0; k < 3; k++) count += vertex_owner[ tris[t * 3 + k] ] != id;
+            return count;
+        };
+
+        while (meshlet.index_count / 3 < max_triangles) {
+            // Prefer the neighbouring triangle that adds the fewest vertices.
+            uint32_t best = UINT32_MAX;
+            uint32_t best_cost = UINT32_MAX;
+            for (uint32_t v : meshlet_vertices) {
+                for (uint32_t j = offsets[v]; j < offsets[v + 1]; j++) {
+                    uint32_t t = adjacency[j];
+                    if (emitted[t]) continue;
+                    uint32_t cost = new_vertices(t);
+                    if (cost < best_cost) {
+                        best = t;
+                        best_cost = cost;
+                    }
+                }
+            }
+            if (best == UINT32_MAX) {
+                // Nothing adjacent is left; only start from a new seed when
+                // the meshlet is still empty to keep it compact.
+                if (meshlet.index_count > 0) break;
+                while (emitted[next_seed]) next_seed++;
+                best = next_seed;
+                best_cost = 3;
+            }
+            if (meshlet_vertices.size() + best_cost > max_vertices) break;
+
+            emitted[best] = true;
+            for (uint32_t k = 0; k < 3; k++) {
+                uint32_t v = tris[best * 3 + k];
+                if (vertex_owner[v] != id) {
+                    vertex_owner[v] = id;
+                    meshlet_vertices.push_back(v);
+                }
+                reordered.push_back(v);
+            }
+            meshlet.index_count += 3;
+        }
+        meshlets.push_back(meshlet);
+    }
+
+    std::copy(reordered.begin(), reordered.end(), indices.begin() + first_index);
+    for (Meshlet &meshlet : meshlets) compute_meshlet_bounds(positions, indices, meshlet);
+    return meshlets;
+}
+
+vktest::Frustum vktest::extract_frustum (const glm::mat4 &matrix) noexcept {
+    // Gribb & Hartmann: each plane is a sum or difference of the rows of the
+    // matrix (GLM is column major, so row i is matrix[*][i]).
+    auto row = [&matrix](int i) {
+        return glm::vec4(matrix[0][i], matrix[1][i], matrix[2][i], matrix[3][i]);
+    };
+    Frustum frustum {};
+    frustum.planes[0] = row(3) + row(0);
+    frustum.planes[1] = row(3) - row(0);
+    frustum.planes[2] = row(3) + row(1);
+    frustum.planes[3] = row(3) - row(1);
+    // With a [0, 1] depth range the near plane is z >= 0.
+    frustum.planes[4] = row(2);
+    frustum.planes[5] = row(3) - row(2);
+    for (glm::vec4 &plane : frustum.planes) {
+        plane = plane / glm::length(glm::vec3(plane));
+    }
+    return frustum;
+}
+
+bool vktest::is_sphere_in_frustum (const Frustum &frustum, const BoundingSphere &sphere) noexcept {
+    for (const glm::vec4 &plane : frustum.planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) return false;
+    }
+    return true;
+}
+
+bool vktest::is_meshlet_backfacing (const Meshlet &meshlet, const glm::vec3 &camera_position) noexcept {
+    glm::vec3 view = meshlet.bounds.center - camera_position;
+    return glm::dot(view, meshlet.cone_axis) >= meshlet.cone_cutoff * glm::length(view) + meshlet.bounds.radius;
+}
@@ -0,0 +1,90 @@
+#ifndef __VKTEST_MESH_HPP__
+#define __VKTEST_MESH_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+
+namespace vktest {
+    struct BoundingSphere {
+        glm::vec3 center;
+        float radius;
+    };
+
+    /**
+     * A small cluster of triangles that is culled as a whole. Its triangles
+     * are stored contiguously in the index buffer.
+     */
+    struct Meshlet {
+        uint32_t first_index;
+        uint32_t index_count;
+        BoundingSphere bounds;
+        /**
+         * Normal cone: the average triangle normal and the sine of the
+         * angle that the normals deviate from it. A cutoff of 1 means the
+         * cluster can never be back-face culled.
+         */
+        glm::vec3 cone_axis;
+        float cone_cutoff;
+    };
+
+    /**
+     * Frustum planes (left, right, bottom, top, near, far) pointing inwards,
+     * with normalized xyz.
+     */
+    struct Frustum {
+        std::array<glm::vec4, 6> planes;
+    };
+
+    /**
+     * A level of detail of a mesh. All levels share the vertex buffers and
+     * their index ranges are stored back to back in a single index buffer.
+     * Also read by the culling compute shader, keep data/cull.comp in sync.
+     */
+    struct MeshLod {
+        uint32_t first_index;
+        uint32_t index_count;
+        /**
+         * Approximate geometric deviation from the full detail mesh, in
+         * object space units.
+         */
+        float error;
+        uint32_t first_meshlet;
+        uint32_t meshlet_count;
+    };
+
+    BoundingSphere compute_bounding_sphere (const std::vector<glm::vec3> &positions) noexcept;
+
+    /**
+     * Splits the triangles in [first_index, first_index + index_count) into
+     * meshlets of at most *max_vertices* unique vertices and *max_triangles*
+     * triangles. The range is reordered in place so that the triangles of
+     * each meshlet are contiguous; each meshlet grows over neighbouring
+     * triangles to keep it spatially compact.
+     */
+    std::vector<Meshlet> build_meshlets (const std::vector<glm::vec3> &positions,
+                                         std::vector<uint32_t> &indices,
+                                         uint32_t first_index,
+                                         uint32_t index_count,
+                                         uint32_t max_vertices,
+                                         uint32_t max_triangles);
+
+    /**
+     * Extracts the frustum planes from a combined projection matrix; with
+     * proj * view * model the planes are in object space. Expects the
+     * [0, 1] depth range of Vulkan.
+     */
+    Frustum extract_frustum (const glm::mat4 &matrix) noexcept;
+    bool is_sphere_in_frustum (const Frustum &frustum, const BoundingSphere &sphere) noexcept;
+    /**
+     * @return true if every triangle of the meshlet faces away from a viewer
+     * at *camera_position* (in the same space as the meshlet).
+     */
+    bool is_meshlet_backfacing (const Meshlet &meshlet, const glm::vec3 &camera_position) noexcept;
+}
+
+#endif /* __VKTEST_MESH_HPP__ */
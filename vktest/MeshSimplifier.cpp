@@ -0,0 +1,235 @@
+#include "MeshSimplifier.hpp"
+#include <algorithm>
+#include <cmath>
+#include <unordered_map>
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+namespace vktest {
+    struct EdgeCollapse {
+        uint32_t from;
+        uint32_t to;
+        double cost;
+        // The cost divided by the area behind the quadric, a squared
+        // distance.
+        double error;
+    };
+
+    static uint64_t edge_key (uint32_t a, uint32_t b) noexcept {
+        if (a > b) std::swap(a, b);
+        return (static_cast<uint64_t>(a) << 32) | b;
+    }
+}
+
+vktest::MeshSimplifier::MeshSimplifier (const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices)
+        : _positions {&positions},
+          _indices {indices},
+          _quadrics (positions.size(), Quadric {}),
+          _weights (positions.size(), 0.0),
+          _locked (positions.size(), false),
+          _adjacency_offsets {},
+          _adjacency {},
+          _error {0.0} {
+    // Every vertex accumulates the planes of the triangles around it, so the
+    // quadric measures the squared distance to all of those planes, weighted
+    // by the area of the triangles.
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        const glm::vec3 &p0 = positions[_indices[i]], &p1 = positions[_indices[i + 1]], &p2 = positions[_indices[i + 2]];
+        Quadric q = make_plane_quadric(p0, p1, p2);
+        double area = glm::length(glm::cross(p1 - p0, p2 - p0)) * 0.5;
+        for (size_t k = 0; k < 3; k++) {
+            add_quadric(_quadrics[_indices[i + k]], q);
+            _weights[_indices[i + k]] += area;
+        }
+    }
+    lock_borders_and_seams();
+}
+
+bool vktest::MeshSimplifier::simplify (size_t target_index_count) {
+    size_t initial_count = _indices.size();
+    while (_indices.size() > target_index_count) {
+        size_t triangles_to_remove = (_indices.size() - target_index_count + 2) / 3;
+        if (collapse_edges(triangles_to_remove) == 0) break;
+    }
+    return _indices.size() < initial_count;
+}
+
+const std::vector<uint32_t> &vktest::MeshSimplifier::get_indices () const noexcept {
+    return _indices;
+}
+
+float vktest::MeshSimplifier::get_error () const noexcept {
+    return static_cast<float>(std::sqrt(_error));
+}
+
+vktest::MeshSimplifier::Quadric vktest::MeshSimplifier::make_plane_quadric (
+        const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) noexcept {
+    glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+    float area2 = glm::length(n);
+    Quadric q {};
+    if (area2 == 0.0f) return q;
+    n /= area2;
+    double a = n.x, b = n.y, c = n.z, d = -glm::dot(n, p0);
+    // Weighting by area makes large triangles dominate the cost, which
+    // keeps the overall silhouette stable. The reported error divides the
+    // weights out again.
+    double w = area2 * 0.5;
+    q = { a * a * w, a * b * w, a * c * w, a * d * w,
+                     b * b * w, b * c * w, b * d * w,
+                                c * c * w, c * d * w,
+                                           d * d * w };
+    return q;
+}
+
+void vktest::MeshSimplifier::add_quadric (Quadric &dest, const Quadric &src) noexcept {
+    for (size_t i = 0; i < dest.size(); i++) dest[i] += src[i];
+}
+
+double vktest::MeshSimplifier::evaluate_quadric (const Quadric &q, const glm::vec3 &p) noexcept {
+    double x = p.x, y = p.y, z = p.z;
+    double error = q[0] * x * x + 2 * q[1] * x * y + 2 * q[2] * x * z + 2 * q[3] * x
+                 + q[4] * y * y + 2 * q[5] * y * z + 2 * q[6] * y
+                 + q[7] * z * z + 2 * q[8] * z
+                 + q[9];
+    return std::abs(error);
+}
+
+void vktest::MeshSimplifier::lock_borders_and_seams () {
+    const std::vector<glm::vec3> &positions = *_positions;
+
+    // Vertices are unique per (position, color, texture coordinate), so a
+    // position referenced by more than one vertex lies on a seam.
+    std::unordered_map<glm::vec3, uint32_t> position_ids {};
+    std::vector<uint32_t> welded (positions.size());
+    std::vector<uint32_t> welded_count (positions.size(), 0);
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        auto it = position_ids.emplace(positions[i], i).first;
+        welded[i] = it->second;
+        welded_count[it->second]++;
+    }
+    for (uint32_t i = 0; i < positions.size(); i++) {
+        if (welded_count[welded[i]] > 1) _locked[i] = true;
+    }
+
+    // An edge that belongs to only one triangle lies on a border.
+    std::unordered_map<uint64_t, uint32_t> edge_uses {};
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            edge_uses[ edge_key(welded[_indices[i + k]], welded[_indices[i + (k + 1) % 3]]) ]++;
+        }
+    }
+    for (size_t i = 0; i + 2 < _indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t a = _indices[i + k];
+            uint32_t b = _indices[i + (k + 1) % 3];
+            if (edge_uses[ edge_key(welded[a], welded[b]) ] == 1) {
+                _locked[a] = true;
+                _locked[b] = true;
+            }
+        }
+    }
+}
+
+bool vktest::MeshSimplifier::flips_triangle (uint32_t from, uint32_t to, uint32_t triangle) const noexcept {
+    const std::vector<glm::vec3> &positions = *_positions;
+    const uint32_t *tri = &_indices[triangle * 3];
+    // Triangles that contain both endpoints collapse and disappear.
+    if (tri[0] == to || tri[1] == to || tri[2] == to) return false;
+
+    glm::vec3 p[3], q[3];
+    for (size_t k = 0; k < 3; k++) {
+        p[k] = positions[ tri[k] ];
+        q[k] = tri[k] == from ? positions[to] : p[k];
+    }
+    glm::vec3 n0 = glm::cross(p[1] - p[0], p[2] - p[0]);
+    glm::vec3 n1 = glm::cross(q[1] - q[0], q[2] - q[0]);
+    return glm::dot(n0, n1) <= 0.0f;
+}
+
+size_t vktest::MeshSimplifier::collapse_edges (size_t triangles_to_remove) {
+    const std::vector<glm::vec3> &positions = *_positions;
+    size_t vertex_count = positions.size();
+    uint32_t triangle_count = static_cast<uint32_t>(_indices.size() / 3);
+
+    _adjacency_offsets.assign(vertex_count + 1, 0);
+    for (uint32_t index : _indices) _adjacency_offsets[index + 1]++;
+    for (size_t i = 0; i < vertex_count; i++) _adjacency_offsets[i + 1] += _adjacency_offsets[i];
+    _adjacency.resize(_indices.size());
+    std::vector<uint32_t> fill (_adjacency_offsets.begin(), _adjacency_offsets.end() - 1);
+    for (uint32_t t = 0; t < triangle_count; t++) {
+        for (size_t k = 0; k < 3; k++) _adjacency[ fill[ _indices[t * 3 + k] ]++ ] = t;
+    }
+
+    // Candidate collapses in both directions of every edge. The cost of
+    // moving *from* onto *to* is the combined quadric evaluated at *to*.
+    std::vector<EdgeCollapse> collapses {};
+    collapses.reserve(_indices.size() * 2);
+    for (size_t i = 0; i < _indices.size(); i += 3) {
+        for (size_t k = 0; k < 3; k++) {
+            uint32_t a = _indices[i + k];
+            uint32_t b = _indices[i + (k + 1) % 3];
+            Quadric q = _quadrics[a];
+            add_quadric(q, _quadrics[b]);
+            double weight = _weights[a] + _weights[b];
+            if (!_locked[a]) {
+                double cost = evaluate_quadric(q, positions[b]);
+                collapses.push_back({ a, b, cost, weight > 0.0 ? cost / weight : 0.0 });
+            }
+            if (!_locked[b]) {
+                double cost = evaluate_quadric(q, positions[a]);
+                collapses.push_back({ b, a, cost, weight > 0.0 ? cost / weight : 0.0 });
+            }
+        }
+    }
+    std::sort(collapses.begin(), collapses.end(),
+              [](const EdgeCollapse &l, const EdgeCollapse &r) { return l.cost < r.cost; });
+
+    // Apply the cheapest collapses first. A vertex whose neighbourhood has
+    // already changed in this pass is skipped, as its cost is outdated.
+    std::vector<uint32_t> remap (vertex_count);
+    for (uint32_t i = 0; i < vertex_count; i++) remap[i] = i;
+    std::vector<bool> touched (vertex_count, false);
+    size_t removed = 0;
+    size_t applied = 0;
+
+    for (const EdgeCollapse &collapse : collapses) {
+        if (removed >= triangles_to_remove) break;
+        if (touched[collapse.from] || touched[collapse.to]) continue;
+
+        bool flips = false;
+        size_t collapsing = 0;
+        for (uint32_t j = _adjacency_offsets[collapse.from]; j < _adjacency_offsets[collapse.from + 1]; j++) {
+            uint32_t t = _adjacency[j];
+            const uint32_t *tri = &_indices[t * 3];
+            if (tri[0] == collapse.to || tri[1] == collapse.to || tri[2] == collapse.to) collapsing++;
+            if (flips_triangle(collapse.from, collapse.to, t)) { flips = true; break; }
+        }
+        if (flips) continue;
+
+        remap[collapse.from] = collapse.to;
+        add_quadric(_quadrics[collapse.to], _quadrics[collapse.from]);
+        _weights[collapse.to] += _weights[collapse.from];
+        _error = std::max(_error, collapse.error);
+        for (uint32_t j = _adjacency_offsets[collapse.from]; j < _adjacency_offsets[collapse.from + 1]; j++) {
+            const uint32_t *tri = &_indices[ _adjacency[j] * 3 ];
+            for (size_t k = 0; k < 3; k++) touched[ tri[k] ] = true;
+        }
+        removed += collapsing;
+        applied++;
+    }
+    if (applied == 0) return 0;
+
+    // Rewrite the index list and drop the triangles that became degenerate.
+    size_t write = 0;
+    for (size_t i = 0; i < _indices.size(); i += 3) {
+        uint32_t a = remap[ _indices[i] ];
+        uint32_t b = remap[ _indices[i + 1] ];
+        uint32_t c = remap[ _indices[i + 2] ];
+        if (a == b || b == c || c == a) continue;
+        _indices[write++] = a;
+        _indices[write++] = b;
+        _indices[write++] = c;
+    }
+    _indices.resize(write);
+    return applied;
+}
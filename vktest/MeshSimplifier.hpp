@@ -0,0 +1,69 @@
+#ifndef __VKTEST_MESHSIMPLIFIER_HPP__
+#define __VKTEST_MESHSIMPLIFIER_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <array>
+#include <vector>
+
+namespace vktest {
+    /**
+     * Reduces the triangle count of an indexed mesh with quadric error
+     * metrics (Garland & Heckbert). Edges are removed by half-edge collapses,
+     * i.e. a vertex is merged into one of its neighbours, so the simplified
+     * index lists keep referencing the original vertex buffers.
+     *
+     * Vertices on mesh borders and on attribute seams (positions shared by
+     * several vertices, e.g. because of differing texture coordinates) are
+     * never moved, which keeps the outline and the texture mapping intact.
+     *
+     * The simplifier is incremental: each call to simplify() continues from
+     * the previous result, so a LOD chain is produced by calling it with
+     * decreasing targets.
+     */
+    class MeshSimplifier {
+    public:
+        MeshSimplifier (const std::vector<glm::vec3> &positions, const std::vector<uint32_t> &indices);
+        /**
+         * Collapses edges until at most *target_index_count* indices remain
+         * or no further collapse is possible.
+         * @return false if the mesh could not be reduced at all.
+         */
+        bool simplify (size_t target_index_count);
+        const std::vector<uint32_t> &get_indices () const noexcept;
+        /**
+         * @return The largest error introduced so far, as a distance in the
+         * units of the positions: the root of the area-weighted mean squared
+         * distance to the original planes of the collapsed vertices.
+         */
+        float get_error () const noexcept;
+
+    private:
+        // Symmetric 4x4 matrix, upper triangle in row-major order.
+        using Quadric = std::array<double, 10>;
+
+        static Quadric make_plane_quadric (const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2) noexcept;
+        static void add_quadric (Quadric &dest, const Quadric &src) noexcept;
+        static double evaluate_quadric (const Quadric &q, const glm::vec3 &p) noexcept;
+        void lock_borders_and_seams ();
+        bool flips_triangle (uint32_t from, uint32_t to, uint32_t triangle) const noexcept;
+        size_t collapse_edges (size_t triangles_to_remove);
+
+        const std::vector<glm::vec3> *_positions;
+        std::vector<uint32_t> _indices;
+        std::vector<Quadric> _quadrics;
+        // The area of the triangles behind each quadric.
+        std::vector<double> _weights;
+        std::vector<bool> _locked;
+        // Triangles adjacent to each vertex, rebuilt before every pass.
+        std::vector<uint32_t> _adjacency_offsets;
+        std::vector<uint32_t> _adjacency;
+        // A squared distance.
+        double _error;
+    };
+}
+
+#endif /* __VKTEST_MESHSIMPLIFIER_HPP__ */
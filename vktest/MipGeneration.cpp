@@ -0,0 +1,184 @@
+#include "MipGeneration.hpp"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace vktest {
+    // Conversions between 8-bit channels and linear 16-bit ones, as they are
+    // (for alpha and UNORM formats) and from and to sRGB.
+    struct MipTables {
+        uint16_t to_linear[2][256];
+        uint8_t from_linear[2][65536];
+    };
+
+    static float srgb_to_linear (float c) noexcept {
+        return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+    }
+
+    static MipTables make_tables () {
+        MipTables tables {};
+        for (uint32_t i = 0; i < 256; i++) {
+            tables.to_linear[0][i] = static_cast<uint16_t>(i * 257);
+            tables.to_linear[1][i] = static_cast<uint16_t>(srgb_to_linear(i / 255.0f) * 65535.0f + 0.5f);
+        }
+        for (uint32_t i = 0; i < 65536; i++) {
+            tables.from_linear[0][i] = static_cast<uint8_t>((i + 128) / 257);
+        }
+        // Each sRGB value takes the linear values from halfway to the value
+        // below up to halfway to the value above, which rounds like
+        // converting every linear value would, with 256 conversions instead
+        // of 65536.
+        uint32_t linear = 0;
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t end = i == 255 ? 65536
+                                    : static_cast<uint32_t>(std::ceil(srgb_to_linear((i + 0.5f) / 255.0f) * 65535.0f));
+            for (; linear < end; linear++) tables.from_linear[1][linear] = static_cast<uint8_t>(i);
+        }
+        return tables;
+    }
+
+    static const MipTables &get_tables () {
+        static const MipTables tables = make_tables();
+        return tables;
+    }
+
+    static void decode_row (const unsigned char *texels, uint32_t width, bool srgb, uint16_t *row) noexcept {
+        const MipTables &tables = get_tables();
+        for (size_t i = 0; i < static_cast<size_t>(width) * 4; i += 4) {
+            row[i] = tables.to_linear[srgb][texels[i]];
+            row[i + 1] = tables.to_linear[srgb][texels[i + 1]];
+            row[i + 2] = tables.to_linear[srgb][texels[i + 2]];
+            row[i + 3] = tables.to_linear[0][texels[i + 3]];
+        }
+    }
+
+    static void encode_level (const uint16_t *linear, size_t texel_count, bool srgb, unsigned char *texels) noexcept {
+        const MipTables &tables = get_tables();
+        for (size_t i = 0; i < texel_count * 4; i += 4) {
+            texels[i] = tables.from_linear[srgb][linear[i]];
+            texels[i + 1] = tables.from_linear[srgb][linear[i + 1]];
+            texels[i + 2] = tables.from_linear[srgb][linear[i + 2]];
+            texels[i + 3] = tables.from_linear[0][linear[i + 3]];
+        }
+    }
+
+    // The rounded average, as _mm_avg_epu16 and vrhaddq_u16 compute it.
+    static uint16_t average (uint16_t a, uint16_t b) noexcept {
+        return static_cast<uint16_t>((a + b + 1) >> 1);
+    }
+
+    // Averages the 2x2 texels of *row0* and *row1* under each texel of *dst*.
+    // Rows and columns are averaged separately, in that order, so the vector
+    // loops and the scalar tail give the same results.
+    static void downsample_row (const uint16_t *row0,
+                                const uint16_t *row1,
+                                uint32_t src_width,
+                                uint16_t *dst,
+                                uint32_t dst_width) noexcept {
+        uint32_t x = 0;
+        if (src_width >= 2) {
+#if defined(__AVX2__)
+            // Four texels of the destination from eight of each row. The
+            // 64-bit unpacks work within each 128-bit lane, so the results
+            // come out as 0, 2, 1, 3 and are put back in order.
+            for (; x + 4 <= dst_width; x += 4) {
+                __m256i v0 = _mm256_avg_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 8)),
+                                              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 8)));
+                __m256i v1 = _mm256_avg_epu16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(row0 + x * 8 + 16)),
+                                              _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row1 + x * 8 + 16)));
+                __m256i h = _mm256_avg_epu16(_mm256_unpacklo_epi64(v0, v1), _mm256_unpackhi_epi64(v0, v1));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + x * 4), _mm256_permute4x64_epi64(h, _MM_SHUFFLE(3, 1, 2, 0)));
+            }
+#elif defined(__SSE2__) || defined(_M_X64)
+            // Two texels of the destination from four of each row.
+            for (; x + 2 <= dst_width; x += 2) {
+                __m128i v0 = _mm_avg_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8)));
+                __m128i v1 = _mm_avg_epu16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row0 + x * 8 + 8)),
+                                           _mm_loadu_si128(reinterpret_cast<const __m128i*>(row1 + x * 8 + 8)));
+                __m128i h = _mm_avg_epu16(_mm_unpacklo_epi64(v0, v1), _mm_unpackhi_epi64(v0, v1));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + x * 4), h);
+            }
+#elif defined(__ARM_NEON)
+            // Two texels of the destination from four of each row.
+            for (; x + 2 <= dst_width; x += 2) {
+                uint16x8_t v0 = vrhaddq_u16(vld1q_u16(row0 + x * 8), vld1q_u16(row1 + x * 8));
+                uint16x8_t v1 = vrhaddq_u16(vld1q_u16(row0 + x * 8 + 8), vld1q_u16(row1 + x * 8 + 8));
+                uint16x8_t h = vrhaddq_u16(vcombine_u16(vget_low_u16(v0), vget_low_u16(v1)),
+                                           vcombine_u16(vget_high_u16(v0), vget_high_u16(v1)));
+                vst1q_u16(dst + x * 4, h);
+            }
+#endif
+        }
+        for (; x < dst_width; x++) {
+            uint32_t x0 = std::min(x * 2, src_width - 1), x1 = std::min(x * 2 + 1, src_width - 1);
+            for (uint32_t c = 0; c < 4; c++) {
+                dst[x * 4 + c] = average(average(row0[x0 * 4 + c], row1[x0 * 4 + c]),
+                                         average(row0[x1 * 4 + c], row1[x1 * 4 + c]));
+            }
+        }
+    }
+}
+
+uint32_t vktest::get_mip_level_count (uint32_t width, uint32_t height) noexcept {
+    uint32_t count = 1;
+    while (width > 1 || height > 1) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        count++;
+    }
+    return count;
+}
+
+void vktest::generate_mip_levels (VkFormat format,
+                                  const unsigned char *texels,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  const std::vector<unsigned char*> &levels) {
+    if (format != VK_FORMAT_R8G8B8A8_SRGB && format != VK_FORMAT_R8G8B8A8_UNORM) {
+        throw std::runtime_error("Failed to generate mip levels, the format is not supported");
+    }
+    if (levels.empty()) return;
+    bool srgb = format == VK_FORMAT_R8G8B8A8_SRGB;
+
+    // The first level is reduced from the base level two decoded rows at a
+    // time, so the base level is never held in 16 bits as a whole.
+    uint32_t level_width = std::max(width / 2, 1u);
+    uint32_t level_height = std::max(height / 2, 1u);
+    std::vector<uint16_t> rows (static_cast<size_t>(width) * 4 * 2);
+    std::vector<uint16_t> level (static_cast<size_t>(level_width) * level_height * 4);
+    for (uint32_t y = 0; y < level_height; y++) {
+        uint32_t y0 = std::min(y * 2, height - 1), y1 = std::min(y * 2 + 1, height - 1);
+        decode_row(texels + static_cast<size_t>(y0) * width * 4, width, srgb, rows.data());
+        decode_row(texels + static_cast<size_t>(y1) * width * 4, width, srgb, rows.data() + static_cast<size_t>(width) * 4);
+        downsample_row(rows.data(), rows.data() + static_cast<size_t>(width) * 4, width,
+                       level.data() + static_cast<size_t>(y) * level_width * 4, level_width);
+    }
+    encode_level(level.data(), static_cast<size_t>(level_width) * level_height, srgb, levels[0]);
+
+    std::vector<uint16_t> next {};
+    for (size_t i = 1; i < levels.size(); i++) {
+        uint32_t next_width = std::max(level_width / 2, 1u);
+        uint32_t next_height = std::max(level_height / 2, 1u);
+        next.resize(static_cast<size_t>(next_width) * next_height * 4);
+        for (uint32_t y = 0; y < next_height; y++) {
+            uint32_t y0 = std::min(y * 2, level_height - 1), y1 = std::min(y * 2 + 1, level_height - 1);
+            downsample_row(level.data() + static_cast<size_t>(y0) * level_width * 4,
+                           level.data() + static_cast<size_t>(y1) * level_width * 4,
+                           level_width,
+                           next.data() + static_cast<size_t>(y) * next_width * 4, next_width);
+        }
+        encode_level(next.data(), static_cast<size_t>(next_width) * next_height, srgb, levels[i]);
+        std::swap(level, next);
+        level_width = next_width;
+        level_height = next_height;
+    }
+}
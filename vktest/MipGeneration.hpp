@@ -0,0 +1,37 @@
+#ifndef __VKTEST_MIPGENERATION_HPP__
+#define __VKTEST_MIPGENERATION_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <cstdint>
+#include <vector>
+
+namespace vktest {
+    /**
+     * The number of mip levels of a full chain, down to 1x1.
+     */
+    uint32_t get_mip_level_count (uint32_t width, uint32_t height) noexcept;
+    /**
+     * Generates the mip levels of an 8-bit RGBA image on the CPU. Each texel
+     * averages 2x2 texels of the level above (a box filter), the color in
+     * linear space for sRGB formats and alpha as it is. Each dimension is
+     * halved and rounded down, so the last column or row of an odd dimension
+     * is dropped, as with blitting. A dimension of 1 stays 1.
+     *
+     * Between the levels the texels are kept linear at 16 bits per channel,
+     * so the averaging runs on whole texels with SSE2, AVX2 or NEON,
+     * whichever the build targets, and only the conversions to and from 8
+     * bits go through lookup tables. The base level is read once, two rows
+     * at a time, and each level is written once, in order, so the levels may
+     * be mapped staging memory.
+     *
+     * @param levels Where levels 1 and on are written, each tightly packed.
+     */
+    void generate_mip_levels (VkFormat format,
+                              const unsigned char *texels,
+                              uint32_t width,
+                              uint32_t height,
+                              const std::vector<unsigned char*> &levels);
+}
+
+#endif /* __VKTEST_MIPGENERATION_HPP__ */
@@ -0,0 +1,179 @@
+#include "ObjectCache.hpp"
+#include <type_traits>
+
+namespace vktest {
+    template <typename T>
+    static void append_key (std::string &key, const T &value) {
+        static_assert(std::is_trivially_copyable<T>::value, "Keys are made of plain values");
+        key.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    template <typename Table, typename Create>
+    static auto find_or_create (Table &table,
+                                const std::string &key,
+                                Create create,
+                                std::vector<std::shared_ptr<const void>> dependencies = {}) {
+        auto it = table.objects.find(key);
+        if (it != table.objects.end()) {
+            table.hits++;
+            return it->second.object;
+        }
+        table.misses++;
+        auto object = create();
+        table.objects.emplace(key, typename decltype(table.objects)::mapped_type { object, std::move(dependencies) });
+        return object;
+    }
+
+    // Dependent tables go first, so what only they held is released before
+    // the tables it lives in are trimmed.
+    template <typename Table>
+    static void trim_table (Table &table) noexcept {
+        for (auto it = table.objects.begin(); it != table.objects.end(); ) {
+            if (it->second.object.use_count() == 1) {
+                it = table.objects.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    template <typename Table>
+    static ObjectCacheCounts count_table (const Table &table) noexcept {
+        ObjectCacheCounts counts {};
+        counts.hits = table.hits;
+        counts.misses = table.misses;
+        counts.objects = table.objects.size();
+        return counts;
+    }
+}
+
+double vktest::ObjectCacheCounts::hit_rate () const noexcept {
+    size_t lookups = hits + misses;
+    return lookups == 0 ? 0.0 : static_cast<double>(hits) / static_cast<double>(lookups);
+}
+
+vktest::ObjectCache::ObjectCache (const Device &device)
+        : _device {&device},
+          _samplers {},
+          _descriptor_set_layouts {},
+          _pipeline_layouts {},
+          _render_passes {} {
+}
+
+vktest::ObjectCache::ObjectCache (ObjectCache &&other) noexcept
+        : _device {other._device},
+          _samplers (std::move(other._samplers)),
+          _descriptor_set_layouts (std::move(other._descriptor_set_layouts)),
+          _pipeline_layouts (std::move(other._pipeline_layouts)),
+          _render_passes (std::move(other._render_passes)) {
+}
+
+std::shared_ptr<vktest::Sampler> vktest::ObjectCache::get_sampler (VkFilter mag_filter,
+                                                                   VkFilter min_filter,
+                                                                   const AddressModes &address_modes,
+                                                                   float max_anisotropy,
+                                                                   uint32_t mip_levels) {
+    std::string key;
+    append_key(key, mag_filter);
+    append_key(key, min_filter);
+    append_key(key, address_modes.u);
+    append_key(key, address_modes.v);
+    append_key(key, address_modes.w);
+    append_key(key, max_anisotropy);
+    append_key(key, mip_levels);
+    return find_or_create(_samplers, key, [&]() {
+        return std::make_shared<Sampler>(*_device, mag_filter, min_filter, address_modes, max_anisotropy, mip_levels);
+    });
+}
+
+std::shared_ptr<vktest::DescriptorSetLayout> vktest::ObjectCache::get_descriptor_set_layout (
+        const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+        VkDescriptorSetLayoutCreateFlags flags,
+        const std::vector<VkDescriptorBindingFlags> &binding_flags) {
+    std::string key;
+    std::vector<std::shared_ptr<const void>> dependencies;
+    append_key(key, flags);
+    append_key(key, bindings.size());
+    for (const VkDescriptorSetLayoutBinding &binding : bindings) {
+        append_key(key, binding.binding);
+        append_key(key, binding.descriptorType);
+        append_key(key, binding.descriptorCount);
+        append_key(key, binding.stageFlags);
+        // Immutable samplers come from this cache too, so equal samplers
+        // have equal handles. They are kept alive with the layout, so that a
+        // handle cannot be reused by another sampler while it is in a key.
+        append_key(key, binding.pImmutableSamplers != nullptr);
+        if (!binding.pImmutableSamplers) continue;
+        for (uint32_t i = 0; i < binding.descriptorCount; i++) {
+            append_key(key, binding.pImmutableSamplers[i]);
+            for (const auto &entry : _samplers.objects) {
+                if (entry.second.object->get_native() == binding.pImmutableSamplers[i]) {
+                    dependencies.push_back(entry.second.object);
+                }
+            }
+        }
+    }
+    for (VkDescriptorBindingFlags binding_flag : binding_flags) append_key(key, binding_flag);
+    return find_or_create(_descriptor_set_layouts, key, [&]() {
+        return std::make_shared<DescriptorSetLayout>(*_device, bindings, flags, binding_flags);
+    }, std::move(dependencies));
+}
+
+std::shared_ptr<vktest::PipelineLayout> vktest::ObjectCache::get_pipeline_layout (
+        const std::vector<DescriptorSetLayout*> &descriptor_set_layouts) {
+    std::string key;
+    std::vector<std::shared_ptr<const void>> dependencies;
+    for (const DescriptorSetLayout *layout : descriptor_set_layouts) {
+        append_key(key, layout->get_native());
+        for (const auto &entry : _descriptor_set_layouts.objects) {
+            if (entry.second.object.get() == layout) dependencies.push_back(entry.second.object);
+        }
+    }
+    return find_or_create(_pipeline_layouts, key, [&]() {
+        return std::make_shared<PipelineLayout>(*_device, descriptor_set_layouts);
+    }, std::move(dependencies));
+}
+
+std::shared_ptr<vktest::RenderPass> vktest::ObjectCache::get_render_pass (
+        VkFormat format,
+        VkFormat depth_format,
+        VkSampleCountFlagBits msaa_samples,
+        const std::vector<VkSubpassDependency> &dependencies,
+        bool depth_prepass,
+        bool store_depth) {
+    std::string key;
+    append_key(key, format);
+    append_key(key, depth_format);
+    append_key(key, msaa_samples);
+    append_key(key, depth_prepass);
+    append_key(key, store_depth);
+    for (const VkSubpassDependency &dependency : dependencies) {
+        append_key(key, dependency.srcSubpass);
+        append_key(key, dependency.dstSubpass);
+        append_key(key, dependency.srcStageMask);
+        append_key(key, dependency.dstStageMask);
+        append_key(key, dependency.srcAccessMask);
+        append_key(key, dependency.dstAccessMask);
+        append_key(key, dependency.dependencyFlags);
+    }
+    return find_or_create(_render_passes, key, [&]() {
+        return std::make_shared<RenderPass>(*_device, format, depth_format, msaa_samples,
+                                            dependencies, depth_prepass, store_depth);
+    });
+}
+
+void vktest::ObjectCache::trim () noexcept {
+    trim_table(_pipeline_layouts);
+    trim_table(_descriptor_set_layouts);
+    trim_table(_samplers);
+    trim_table(_render_passes);
+}
+
+vktest::ObjectCacheStats vktest::ObjectCache::get_stats () const noexcept {
+    ObjectCacheStats stats {};
+    stats.samplers = count_table(_samplers);
+    stats.descriptor_set_layouts = count_table(_descriptor_set_layouts);
+    stats.pipeline_layouts = count_table(_pipeline_layouts);
+    stats.render_passes = count_table(_render_passes);
+    return stats;
+}
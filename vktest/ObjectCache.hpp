@@ -0,0 +1,95 @@
+#ifndef __VKTEST_OBJECTCACHE_HPP__
+#define __VKTEST_OBJECTCACHE_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "Device.hpp"
+#include "DescriptorSetLayout.hpp"
+#include "PipelineLayout.hpp"
+#include "RenderPass.hpp"
+#include "Sampler.hpp"
+
+namespace vktest {
+    struct ObjectCacheCounts {
+        size_t hits = 0;
+        size_t misses = 0;
+        // The objects currently in the cache.
+        size_t objects = 0;
+
+        double hit_rate () const noexcept;
+    };
+
+    struct ObjectCacheStats {
+        ObjectCacheCounts samplers;
+        ObjectCacheCounts descriptor_set_layouts;
+        ObjectCacheCounts pipeline_layouts;
+        ObjectCacheCounts render_passes;
+    };
+
+    /**
+     * Creates each distinct immutable object once and shares it. Objects are
+     * looked up by the contents of their create info, so asking twice for the
+     * same sampler or layout returns the same handle. Since the set layouts
+     * are shared, pipeline layouts made of equal set layouts are found by
+     * their handles; their set layouts must come from the same cache.
+     */
+    class ObjectCache {
+    public:
+        ObjectCache (const Device &device);
+        ObjectCache (const ObjectCache &) = delete;
+        ObjectCache (ObjectCache &&other) noexcept;
+        std::shared_ptr<Sampler> get_sampler (VkFilter mag_filter,
+                                              VkFilter min_filter,
+                                              const AddressModes &address_modes,
+                                              float max_anisotropy,
+                                              uint32_t mip_levels);
+        std::shared_ptr<DescriptorSetLayout> get_descriptor_set_layout (
+                const std::vector<VkDescriptorSetLayoutBinding> &bindings,
+                VkDescriptorSetLayoutCreateFlags flags = 0,
+                const std::vector<VkDescriptorBindingFlags> &binding_flags = {});
+        std::shared_ptr<PipelineLayout> get_pipeline_layout (
+                const std::vector<DescriptorSetLayout*> &descriptor_set_layouts);
+        std::shared_ptr<RenderPass> get_render_pass (VkFormat format,
+                                                     VkFormat depth_format,
+                                                     VkSampleCountFlagBits msaa_samples,
+                                                     const std::vector<VkSubpassDependency> &dependencies,
+                                                     bool depth_prepass = false,
+                                                     bool store_depth = true);
+        /**
+         * Destroys the objects only the cache still holds. Objects retired
+         * for frames in flight are still held by the deletion queue, so they
+         * are kept until it lets them go.
+         */
+        void trim () noexcept;
+        ObjectCacheStats get_stats () const noexcept;
+
+    private:
+        template <typename T>
+        struct Entry {
+            std::shared_ptr<T> object;
+            // Cached objects the key refers to by handle, kept alive so that
+            // their handles are not reused while the key is in the cache.
+            std::vector<std::shared_ptr<const void>> dependencies;
+        };
+        template <typename T>
+        struct Table {
+            // Keyed by the bytes of the create info, so equal keys are equal
+            // objects, not only equal hashes.
+            std::unordered_map<std::string, Entry<T>> objects {};
+            size_t hits = 0;
+            size_t misses = 0;
+        };
+
+        const Device *_device;
+        Table<Sampler> _samplers;
+        Table<DescriptorSetLayout> _descriptor_set_layouts;
+        Table<PipelineLayout> _pipeline_layouts;
+        Table<RenderPass> _render_passes;
+    };
+}
+
+#endif /* __VKTEST_OBJECTCACHE_HPP__ */
@@ -4,6 +4,7 @@
 #include <vector>
 #include <stdexcept>
 #include <set>
+#include <cstring>
 
 namespace vktest {
     static QueueFamilyIndices find_queue_families (VkPhysicalDevice device, VkSurfaceKHR surface) noexcept {
@@ -134,3 +135,65 @@ vktest::PhysicalDevice::PhysicalDevice (VkPhysicalDevice native, const Surface &
     _native = native;
     _queue_families = find_queue_families(_native, surface.get_native());
 }
+
+VkPhysicalDeviceFeatures vktest::PhysicalDevice::get_features () const noexcept {
+    VkPhysicalDeviceFeatures features {};
+    vkGetPhysicalDeviceFeatures(_native, &features);
+    return features;
+}
+
+VkPhysicalDeviceVulkan12Features vktest::PhysicalDevice::get_vulkan12_features () const noexcept {
+    VkPhysicalDeviceVulkan12Features features12 {};
+    features12.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+    if (get_properties().apiVersion < VK_API_VERSION_1_2) return features12;
+
+    // Feature structs of newer versions and extensions are chained to
+    // VkPhysicalDeviceFeatures2 through pNext.
+    VkPhysicalDeviceFeatures2 features2 {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &features12;
+    vkGetPhysicalDeviceFeatures2(_native, &features2);
+    features12.pNext = nullptr;
+    return features12;
+}
+
+VkPhysicalDeviceDynamicRenderingFeatures vktest::PhysicalDevice::get_dynamic_rendering_features () const noexcept {
+    VkPhysicalDeviceDynamicRenderingFeatures rendering_features {};
+    rendering_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    if (get_properties().apiVersion < VK_API_VERSION_1_3 && !supports_extension(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME)) {
+        return rendering_features;
+    }
+
+    VkPhysicalDeviceFeatures2 features2 {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &rendering_features;
+    vkGetPhysicalDeviceFeatures2(_native, &features2);
+    rendering_features.pNext = nullptr;
+    return rendering_features;
+}
+
+VkPhysicalDeviceSynchronization2Features vktest::PhysicalDevice::get_synchronization2_features () const noexcept {
+    VkPhysicalDeviceSynchronization2Features sync2_features {};
+    sync2_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+    if (get_properties().apiVersion < VK_API_VERSION_1_3 && !supports_extension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME)) {
+        return sync2_features;
+    }
+
+    VkPhysicalDeviceFeatures2 features2 {};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &sync2_features;
+    vkGetPhysicalDeviceFeatures2(_native, &features2);
+    sync2_features.pNext = nullptr;
+    return sync2_features;
+}
+
+bool vktest::PhysicalDevice::supports_extension (const char *name) const noexcept {
+    uint32_t count;
+    vkEnumerateDeviceExtensionProperties(_native, nullptr, &count, nullptr);
+    std::vector<VkExtensionProperties> availables {count};
+    vkEnumerateDeviceExtensionProperties(_native, nullptr, &count, availables.data());
+    for (const VkExtensionProperties &ext : availables) {
+        if (std::strcmp(ext.extensionName, name) == 0) return true;
+    }
+    return false;
+}
@@ -22,6 +22,25 @@ namespace vktest {
         VkPhysicalDeviceMemoryProperties get_memory_properties () const noexcept;
         VkPhysicalDeviceProperties get_properties () const noexcept;
         VkFormatProperties get_format_properties (VkFormat format) const noexcept;
+        VkPhysicalDeviceFeatures get_features () const noexcept;
+        /**
+         * @return The Vulkan 1.2 features, all false if the device does not
+         * support Vulkan 1.2.
+         */
+        VkPhysicalDeviceVulkan12Features get_vulkan12_features () const noexcept;
+        /**
+         * @return The dynamic rendering feature, core in Vulkan 1.3 and
+         * provided by VK_KHR_dynamic_rendering before. False if neither is
+         * supported.
+         */
+        VkPhysicalDeviceDynamicRenderingFeatures get_dynamic_rendering_features () const noexcept;
+        /**
+         * @return The synchronization2 feature, core in Vulkan 1.3 and
+         * provided by VK_KHR_synchronization2 before. False if neither is
+         * supported.
+         */
+        VkPhysicalDeviceSynchronization2Features get_synchronization2_features () const noexcept;
+        bool supports_extension (const char *name) const noexcept;
 
     private:
         static std::unique_ptr<PhysicalDevice> select (const Instance &instance, const Surface &surface);
@@ -1,5 +1,4 @@
 #include "Pipeline.hpp"
-#include "Vertex.hpp"
 #include <optional>
 #include <stdexcept>
 
@@ -78,12 +77,13 @@ namespace vktest {
         return create_info;
     }
 
-    static VkPipelineMultisampleStateCreateInfo prepare_multisample_info (VkSampleCountFlagBits msaa_samples) noexcept {
+    static VkPipelineMultisampleStateCreateInfo prepare_multisample_info (VkSampleCountFlagBits msaa_samples,
+                                                                         bool sample_shading) noexcept {
         // Enabling it requires enabling a GPU feature.
         VkPipelineMultisampleStateCreateInfo create_info {};
         create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
         create_info.rasterizationSamples = msaa_samples;
-        create_info.sampleShadingEnable = VK_TRUE;
+        create_info.sampleShadingEnable = sample_shading ? VK_TRUE : VK_FALSE;
         // Min fraction for sample shading; closer to one is smoother.
         create_info.minSampleShading = 0.2f; // Optional
         create_info.pSampleMask = nullptr; // Optional
@@ -92,7 +92,7 @@ namespace vktest {
         return create_info;
     }
 
-    static std::optional<VkPipelineDepthStencilStateCreateInfo> prepare_depth_stencil_info () noexcept {
+    static std::optional<VkPipelineDepthStencilStateCreateInfo> prepare_depth_stencil_info (const PipelineOptions &options) noexcept {
         VkPipelineDepthStencilStateCreateInfo info {};
         info.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
         // depthTestEnable: Specifies if the depth of new fragments should be
@@ -100,9 +100,11 @@ namespace vktest {
         info.depthTestEnable = VK_TRUE;
         // depthWriteEnable: Specifies if the new depth of fragments that pass
         // the depth test should actually be written to the depth buffer.
-        info.depthWriteEnable = VK_TRUE;
-        // Specifies the comparison that is performed to keep or discard fragments.
-        info.depthCompareOp = VK_COMPARE_OP_LESS;
+        info.depthWriteEnable = options.depth_write ? VK_TRUE : VK_FALSE;
+        // Specifies the comparison that is performed to keep or discard
+        // fragments. After a depth pre-pass, VK_COMPARE_OP_EQUAL keeps only
+        // the fragments that ended up visible.
+        info.depthCompareOp = options.depth_compare_op;
 
         // Optional depth bound test: this allows you to only keep fragments
         // that fall within the specified depth range.
@@ -116,7 +118,7 @@ namespace vktest {
         return info;
     }
 
-    static VkPipelineColorBlendAttachmentState prepare_color_blend_attachment () noexcept {
+    static VkPipelineColorBlendAttachmentState prepare_color_blend_attachment (bool color_output) noexcept {
         // There are two types of structs to configure color blending. The
         // first struct, VkPipelineColorBlendAttachmentState contains the
         // configuration per attached framebuffer and the second struct,
@@ -124,7 +126,9 @@ namespace vktest {
         // blending settings.
         VkPipelineColorBlendAttachmentState state {};
         // colorWriteMask determines which channels are actually passed through.
-        state.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+        // A depth-only pipeline may still have to declare the color attachment
+        // (with dynamic rendering), but writes nothing to it.
+        state.colorWriteMask = color_output ? VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT : 0;
         // If blendEnable is set to VK_FALSE, then the new color from the
         // fragment shader is passed through unmodified. Otherwise, the two
         // mixing operations are performed to compute a new color.
@@ -150,7 +154,8 @@ namespace vktest {
         return state;
     }
 
-    static VkPipelineColorBlendStateCreateInfo prepare_color_blend_info (const VkPipelineColorBlendAttachmentState &color_blend_state) noexcept {
+    static VkPipelineColorBlendStateCreateInfo prepare_color_blend_info (const VkPipelineColorBlendAttachmentState &color_blend_state,
+                                                                         uint32_t attachment_count) noexcept {
         VkPipelineColorBlendStateCreateInfo create_info {};
         create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         // If you want to use the second method of blending (bitwise
@@ -160,8 +165,9 @@ namespace vktest {
         // (VkPipelineColorBlendAttachmentState).
         create_info.logicOpEnable = VK_FALSE;
         create_info.logicOp = VK_LOGIC_OP_COPY; // Optional
-        create_info.attachmentCount = 1;
-        create_info.pAttachments = &color_blend_state;
+        // Must match the number of color attachments of the subpass.
+        create_info.attachmentCount = attachment_count;
+        create_info.pAttachments = attachment_count > 0 ? &color_blend_state : nullptr;
         create_info.blendConstants[0] = 0.0f; // Optional
         create_info.blendConstants[1] = 0.0f; // Optional
         create_info.blendConstants[2] = 0.0f; // Optional
@@ -169,8 +175,15 @@ namespace vktest {
         return create_info;
     }
 
-    static std::optional<VkPipelineDynamicStateCreateInfo> prepare_dynamic_state_info () noexcept {
-        return std::nullopt;
+    static std::optional<VkPipelineDynamicStateCreateInfo> prepare_dynamic_state_info (bool dynamic_viewport) noexcept {
+        if (!dynamic_viewport) return std::nullopt;
+        // The values given at creation time for these states are ignored.
+        static const VkDynamicState dynamic_states[] = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+        VkPipelineDynamicStateCreateInfo create_info {};
+        create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        create_info.dynamicStateCount = 2;
+        create_info.pDynamicStates = dynamic_states;
+        return create_info;
     }
 }
 
@@ -178,22 +191,61 @@ vktest::Pipeline::Pipeline (const PipelineLayout &layout,
                             const VkViewport &viewport,
                             const VkRect2D &scissor,
                             const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                            const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                            const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
                             const RenderPass &render_pass,
-                            VkSampleCountFlagBits msaa_samples) : _layout {&layout} {
-    std::vector<VkVertexInputBindingDescription> binding_descs = Vertex::get_binding_descs();
-    std::vector<VkVertexInputAttributeDescription> attrib_descs = Vertex::get_attribute_descs();
+                            VkSampleCountFlagBits msaa_samples,
+                            const PipelineOptions &options) : _layout {&layout} {
+    // The depth-only subpass has no color attachment.
+    uint32_t color_attachment_count = options.color_output ? 1 : 0;
+    create(viewport, scissor, stages, binding_descs, attrib_descs,
+           render_pass.get_native(), nullptr, color_attachment_count, msaa_samples, options);
+}
+
+vktest::Pipeline::Pipeline (const PipelineLayout &layout,
+                            const VkViewport &viewport,
+                            const VkRect2D &scissor,
+                            const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                            const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                            const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+                            const RenderingFormats &formats,
+                            VkSampleCountFlagBits msaa_samples,
+                            const PipelineOptions &options) : _layout {&layout} {
+    // Instead of a subpass, the pipeline states the formats of the
+    // attachments it renders to.
+    uint32_t color_attachment_count = formats.color_format != VK_FORMAT_UNDEFINED ? 1 : 0;
+    VkPipelineRenderingCreateInfo rendering_info {};
+    rendering_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    rendering_info.colorAttachmentCount = color_attachment_count;
+    rendering_info.pColorAttachmentFormats = &formats.color_format;
+    rendering_info.depthAttachmentFormat = formats.depth_format;
+    create(viewport, scissor, stages, binding_descs, attrib_descs,
+           VK_NULL_HANDLE, &rendering_info, color_attachment_count, msaa_samples, options);
+}
+
+void vktest::Pipeline::create (const VkViewport &viewport,
+                               const VkRect2D &scissor,
+                               const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                               const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                               const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+                               VkRenderPass render_pass,
+                               const void *next,
+                               uint32_t color_attachment_count,
+                               VkSampleCountFlagBits msaa_samples,
+                               const PipelineOptions &options) {
     auto vertex_input_info = prepare_vertex_input_info(binding_descs, attrib_descs);
     auto input_assemnly = prepare_input_assembly_info();
     auto viewport_state = prepare_viewport_info(viewport, scissor);
     auto rasterizer = prepare_rasterizer_info();
-    auto multisampling = prepare_multisample_info(msaa_samples);
-    auto depth_stencil = prepare_depth_stencil_info();
-    auto color_blend_attachment = prepare_color_blend_attachment();
-    auto color_blending = prepare_color_blend_info(color_blend_attachment);
-    auto dynamic_state = prepare_dynamic_state_info();
+    auto multisampling = prepare_multisample_info(msaa_samples, options.sample_shading);
+    auto depth_stencil = prepare_depth_stencil_info(options);
+    auto color_blend_attachment = prepare_color_blend_attachment(options.color_output);
+    auto color_blending = prepare_color_blend_info(color_blend_attachment, color_attachment_count);
+    auto dynamic_state = prepare_dynamic_state_info(options.dynamic_viewport);
 
     VkGraphicsPipelineCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    create_info.pNext = next;
     create_info.stageCount = static_cast<uint32_t>( stages.size() );
     create_info.pStages = stages.data();
 
@@ -208,9 +260,9 @@ vktest::Pipeline::Pipeline (const PipelineLayout &layout,
 
     create_info.layout = _layout->get_native();
 
-    create_info.renderPass = render_pass.get_native();
+    create_info.renderPass = render_pass;
     // The index of the sub-pass where this graphics pipeline will be used.
-    create_info.subpass = 0;
+    create_info.subpass = options.subpass;
 
     // Vulkan allows you to create a new graphics pipeline by deriving from an
     // existing pipeline. These values are only used if the
@@ -220,7 +272,7 @@ vktest::Pipeline::Pipeline (const PipelineLayout &layout,
     create_info.basePipelineIndex = -1; // Optional
 
     VkResult res = vkCreateGraphicsPipelines(_layout->get_device().get_native(), VK_NULL_HANDLE, 1, &create_info, nullptr, &_native);
-    if (res != VK_SUCCESS) std::runtime_error("Failed to create graphics pipeline");
+    if (res != VK_SUCCESS) throw std::runtime_error("Failed to create graphics pipeline");
 }
 
 vktest::Pipeline::Pipeline (Pipeline &&other) noexcept {
@@ -8,14 +8,56 @@
 #include "RenderPass.hpp"
 
 namespace vktest {
+    /**
+     * Fixed-function state that differs between the pipelines of the
+     * application.
+     */
+    struct PipelineOptions {
+        // The index of the subpass of the render pass the pipeline is used in.
+        uint32_t subpass = 0;
+        VkCompareOp depth_compare_op = VK_COMPARE_OP_LESS;
+        bool depth_write = true;
+        // A depth-only pipeline has no color attachment to blend into.
+        bool color_output = true;
+        bool sample_shading = true;
+        // The viewport and the scissor are set while recording instead, so
+        // the render size can change without recreating the pipeline.
+        bool dynamic_viewport = false;
+    };
+
+    /**
+     * The attachment formats of a pipeline used with dynamic rendering
+     * instead of a render pass. VK_FORMAT_UNDEFINED for an unused attachment.
+     */
+    struct RenderingFormats {
+        VkFormat color_format = VK_FORMAT_UNDEFINED;
+        VkFormat depth_format = VK_FORMAT_UNDEFINED;
+    };
+
     class Pipeline {
     public:
         Pipeline (const PipelineLayout &layout,
                   const VkViewport &viewport,
                   const VkRect2D &scissor,
                   const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                  const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                  const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
                   const RenderPass &render_pass,
-                  VkSampleCountFlagBits msaa_samples);
+                  VkSampleCountFlagBits msaa_samples,
+                  const PipelineOptions &options = PipelineOptions {});
+        /**
+         * Creates a pipeline for dynamic rendering, *options.subpass* is
+         * ignored.
+         */
+        Pipeline (const PipelineLayout &layout,
+                  const VkViewport &viewport,
+                  const VkRect2D &scissor,
+                  const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                  const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                  const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+                  const RenderingFormats &formats,
+                  VkSampleCountFlagBits msaa_samples,
+                  const PipelineOptions &options = PipelineOptions {});
         Pipeline (const Pipeline &) = delete;
         Pipeline (Pipeline &&other) noexcept;
         ~Pipeline ();
@@ -23,6 +65,17 @@ namespace vktest {
         const PipelineLayout &get_layout () const noexcept;
 
     private:
+        void create (const VkViewport &viewport,
+                     const VkRect2D &scissor,
+                     const std::vector<VkPipelineShaderStageCreateInfo> &stages,
+                     const std::vector<VkVertexInputBindingDescription> &binding_descs,
+                     const std::vector<VkVertexInputAttributeDescription> &attrib_descs,
+                     VkRenderPass render_pass,
+                     const void *next,
+                     uint32_t color_attachment_count,
+                     VkSampleCountFlagBits msaa_samples,
+                     const PipelineOptions &options);
+
         VkPipeline _native;
         const PipelineLayout *_layout;
     };
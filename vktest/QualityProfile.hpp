@@ -0,0 +1,26 @@
+#ifndef __VKTEST_QUALITYPROFILE_HPP__
+#define __VKTEST_QUALITYPROFILE_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+
+namespace vktest {
+    /**
+     * A set of rendering settings trading image quality for frame time.
+     */
+    struct QualityProfile {
+        const char *name;
+        /**
+         * The highest MSAA sample count to use, lowered to what the device
+         * supports.
+         */
+        VkSampleCountFlagBits max_samples;
+        bool sample_shading;
+        /**
+         * 0 disables anisotropic filtering. Capped by the device limit.
+         */
+        float max_anisotropy;
+    };
+}
+
+#endif /* __VKTEST_QUALITYPROFILE_HPP__ */
@@ -0,0 +1,43 @@
+#include "QueryPool.hpp"
+#include <stdexcept>
+
+vktest::QueryPool::QueryPool (const Device &device, VkQueryType type, uint32_t query_count)
+        : _device {&device}, _query_count {query_count} {
+    VkQueryPoolCreateInfo create_info {};
+    create_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    create_info.queryType = type;
+    create_info.queryCount = query_count;
+    VkResult res = vkCreateQueryPool(device.get_native(), &create_info, nullptr, &_native);
+    if (res != VK_SUCCESS) throw std::runtime_error("Failed to create query pool");
+}
+
+vktest::QueryPool::QueryPool (QueryPool &&other) noexcept {
+    _native = other._native;
+    _device = other._device;
+    _query_count = other._query_count;
+    other._native = nullptr;
+}
+
+vktest::QueryPool::~QueryPool () {
+    if (_native != nullptr) vkDestroyQueryPool(_device->get_native(), _native, nullptr);
+}
+
+VkQueryPool vktest::QueryPool::get_native () const noexcept {
+    return _native;
+}
+
+uint32_t vktest::QueryPool::get_query_count () const noexcept {
+    return _query_count;
+}
+
+std::vector<uint64_t> vktest::QueryPool::get_results (uint32_t first, uint32_t count) const {
+    std::vector<uint64_t> results (count);
+    // Without VK_QUERY_RESULT_WAIT_BIT the call returns VK_NOT_READY instead
+    // of blocking when a query has not completed.
+    VkResult res = vkGetQueryPoolResults(_device->get_native(), _native, first, count,
+                                         results.size() * sizeof(uint64_t), results.data(),
+                                         sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+    if (res == VK_NOT_READY) return std::vector<uint64_t> {};
+    if (res != VK_SUCCESS) throw std::runtime_error("Failed to get query pool results");
+    return results;
+}
@@ -0,0 +1,34 @@
+#ifndef __VKTEST_QUERYPOOL_HPP__
+#define __VKTEST_QUERYPOOL_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <vector>
+#include "Device.hpp"
+
+namespace vktest {
+    class Device;
+
+    class QueryPool {
+    public:
+        QueryPool (const Device &device, VkQueryType type, uint32_t query_count);
+        QueryPool (const QueryPool &) = delete;
+        QueryPool (QueryPool &&other) noexcept;
+        ~QueryPool ();
+        VkQueryPool get_native () const noexcept;
+        uint32_t get_query_count () const noexcept;
+        /**
+         * Reads the 64-bit results of *count* queries starting at *first*.
+         *
+         * @return Empty if any of the results is not available yet.
+         */
+        std::vector<uint64_t> get_results (uint32_t first, uint32_t count) const;
+
+    private:
+        VkQueryPool _native;
+        const Device *_device;
+        uint32_t _query_count;
+    };
+}
+
+#endif /* __VKTEST_QUERYPOOL_HPP__ */
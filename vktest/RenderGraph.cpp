@@ -0,0 +1,350 @@
+#include "RenderGraph.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <iterator>
+#include <utility>
+
+namespace vktest {
+    static std::optional<uint32_t> find_memory_type (const PhysicalDevice &physical_device,
+                                                     uint32_t type_filter,
+                                                     VkMemoryPropertyFlags properties) {
+        VkPhysicalDeviceMemoryProperties memprops = physical_device.get_memory_properties();
+        for (uint32_t i = 0; i < memprops.memoryTypeCount; i++) {
+            if (type_filter & (1 << i)
+             && (memprops.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+        return std::nullopt;
+    }
+}
+
+vktest::RenderGraphPass::RenderGraphPass (std::string name, Record record)
+        : _name {std::move(name)}, _record {std::move(record)}, _accesses {}, _dependencies {}, _side_effects {false} {
+}
+
+const std::string &vktest::RenderGraphPass::get_name () const noexcept {
+    return _name;
+}
+
+vktest::RenderGraphPass &vktest::RenderGraphPass::read (RenderGraphImage image,
+                                                        VkImageLayout layout,
+                                                        VkPipelineStageFlags stages,
+                                                        VkAccessFlags access) {
+    _accesses.push_back(Access { image, ImageAccess { layout, stages, access }, false, false });
+    return *this;
+}
+
+vktest::RenderGraphPass &vktest::RenderGraphPass::write (RenderGraphImage image,
+                                                         VkImageLayout layout,
+                                                         VkPipelineStageFlags stages,
+                                                         VkAccessFlags access,
+                                                         bool discard) {
+    _accesses.push_back(Access { image, ImageAccess { layout, stages, access }, true, discard });
+    return *this;
+}
+
+vktest::RenderGraphPass &vktest::RenderGraphPass::set_side_effects () noexcept {
+    _side_effects = true;
+    return *this;
+}
+
+vktest::RenderGraphPass &vktest::RenderGraphPass::depend_on (std::string name) {
+    _dependencies.push_back( std::move(name) );
+    return *this;
+}
+
+vktest::RenderGraph::RenderGraph (const Device &device)
+        : _device {&device}, _memories {}, _lazy_memories {}, _resources {}, _passes {}, _schedule {}, _stats {} {
+}
+
+vktest::RenderGraph::RenderGraph (RenderGraph &&other) noexcept
+        : _device {other._device},
+          _memories (std::move(other._memories)),
+          _lazy_memories (std::move(other._lazy_memories)),
+          _resources (std::move(other._resources)),
+          _passes (std::move(other._passes)),
+          _schedule (std::move(other._schedule)),
+          _stats {other._stats} {
+}
+
+vktest::RenderGraphImage vktest::RenderGraph::import_image (const Image &image) {
+    Resource resource {};
+    resource.image = &image;
+    _resources.push_back( std::move(resource) );
+    return static_cast<RenderGraphImage>(_resources.size() - 1);
+}
+
+vktest::RenderGraphImage vktest::RenderGraph::create_image (const VkImageCreateInfo &info, bool transient) {
+    Resource resource {};
+    resource.info = info;
+    resource.transient = transient;
+    _resources.push_back( std::move(resource) );
+    return static_cast<RenderGraphImage>(_resources.size() - 1);
+}
+
+vktest::RenderGraphPass &vktest::RenderGraph::add_pass (std::string name, RenderGraphPass::Record record) {
+    _passes.emplace_back(std::move(name), std::move(record));
+    return _passes.back();
+}
+
+void vktest::RenderGraph::compile () {
+    std::vector<std::vector<size_t>> dependencies = find_dependencies();
+    std::vector<bool> alive = cull_passes(dependencies);
+    _schedule = schedule_passes(alive, dependencies);
+
+    // The lifetime of every image, in scheduled passes.
+    for (size_t i = 0; i < _schedule.size(); i++) {
+        for (const RenderGraphPass::Access &access : _passes[_schedule[i]]._accesses) {
+            Resource &resource = _resources[access.image];
+            if (!resource.first_pass) resource.first_pass = i;
+            resource.last_pass = i;
+            resource.last_access = access.access;
+        }
+    }
+    allocate_images();
+
+    _stats.pass_count = _passes.size();
+    _stats.culled_pass_count = static_cast<size_t>(std::count(alive.begin(), alive.end(), false));
+}
+
+const vktest::Image &vktest::RenderGraph::get_image (RenderGraphImage image) const noexcept {
+    return *_resources[image].image;
+}
+
+const vktest::RenderGraphStats &vktest::RenderGraph::get_stats () const noexcept {
+    return _stats;
+}
+
+VkDeviceSize vktest::RenderGraph::get_committed_lazy_size () const noexcept {
+    VkDeviceSize size = 0;
+    for (const DeviceMemory *memory : _lazy_memories) size += memory->get_commitment();
+    return size;
+}
+
+void vktest::RenderGraph::execute (const CommandBuffer &cmdbuf, uint32_t image_index) const {
+    for (size_t i = 0; i < _schedule.size(); i++) {
+        const RenderGraphPass &pass = _passes[_schedule[i]];
+        // The barriers of a pass are recorded together.
+        for (const RenderGraphPass::Access &access : pass._accesses) {
+            const Resource &resource = _resources[access.image];
+            // Transient images start out undefined in every frame.
+            bool first_use = resource.transient && resource.first_pass == i;
+            if (first_use && resource.aliased) {
+                // The memory was used by another image before, its accesses
+                // have to finish first.
+                const Resource &previous = _resources[*resource.aliased];
+                cmdbuf.add_memory_barrier(previous.last_access.stages, previous.last_access.access,
+                                          access.access.stages, access.access.access);
+            }
+            cmdbuf.transition_image(*resource.image, access.access.layout, access.access.stages, access.access.access,
+                                    access.discard || first_use);
+        }
+        cmdbuf.flush_barriers();
+        pass._record(cmdbuf, image_index);
+    }
+}
+
+std::vector<std::vector<size_t>> vktest::RenderGraph::find_dependencies () const {
+    std::vector<std::vector<size_t>> dependencies (_passes.size());
+    for (size_t i = 0; i < _passes.size(); i++) {
+        for (const std::string &name : _passes[i]._dependencies) {
+            auto pass = std::find_if(_passes.begin(), _passes.begin() + i,
+                                     [&name](const RenderGraphPass &pass) { return pass._name == name; });
+            if (pass == _passes.begin() + i) {
+                throw std::runtime_error("Failed to compile render graph, pass " + _passes[i]._name
+                                         + " depends on " + name + ", which is not added before it");
+            }
+            dependencies[i].push_back( static_cast<size_t>(pass - _passes.begin()) );
+        }
+    }
+    return dependencies;
+}
+
+std::vector<bool> vktest::RenderGraph::cull_passes (const std::vector<std::vector<size_t>> &dependencies) const {
+    std::vector<bool> alive (_passes.size(), false);
+    // Whether a later pass needs the current contents of each image.
+    std::vector<bool> needed (_resources.size(), false);
+    // Whether a later pass that is kept depends on each pass.
+    std::vector<bool> required (_passes.size(), false);
+    for (size_t i = _passes.size(); i-- > 0;) {
+        const RenderGraphPass &pass = _passes[i];
+        // Images that are not transient outlive the frame, so writing them is
+        // a result of its own.
+        bool used = pass._side_effects || required[i];
+        for (const RenderGraphPass::Access &access : pass._accesses) {
+            if (access.write && (needed[access.image] || !_resources[access.image].transient)) used = true;
+        }
+        if (!used) continue;
+
+        alive[i] = true;
+        for (size_t dependency : dependencies[i]) required[dependency] = true;
+        for (const RenderGraphPass::Access &access : pass._accesses) {
+            if (access.write && access.discard) needed[access.image] = false;
+        }
+        for (const RenderGraphPass::Access &access : pass._accesses) {
+            if (!access.write || !access.discard) needed[access.image] = true;
+        }
+    }
+    return alive;
+}
+
+std::vector<size_t> vktest::RenderGraph::schedule_passes (const std::vector<bool> &alive,
+                                                          const std::vector<std::vector<size_t>> &dependencies) const {
+    // A pass depends on the last pass that wrote an image it accesses, and a
+    // write also on the reads of the previous contents. Explicit
+    // dependencies come on top.
+    std::vector<std::vector<size_t>> dependents (_passes.size());
+    std::vector<size_t> dependency_counts (_passes.size(), 0);
+    auto depend = [&dependents, &dependency_counts](size_t pass, size_t dependent) {
+        if (pass == dependent) return;
+        dependents[pass].push_back(dependent);
+        dependency_counts[dependent]++;
+    };
+    std::vector<std::optional<size_t>> writers (_resources.size());
+    std::vector<std::vector<size_t>> readers (_resources.size());
+    std::optional<size_t> side_effects {};
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (!alive[i]) continue;
+        for (size_t dependency : dependencies[i]) depend(dependency, i);
+        for (const RenderGraphPass::Access &access : _passes[i]._accesses) {
+            if (writers[access.image]) depend(*writers[access.image], i);
+            if (access.write) {
+                for (size_t reader : readers[access.image]) depend(reader, i);
+                readers[access.image].clear();
+                writers[access.image] = i;
+            } else {
+                readers[access.image].push_back(i);
+            }
+        }
+        if (_passes[i]._side_effects) {
+            if (side_effects) depend(*side_effects, i);
+            side_effects = i;
+        }
+    }
+
+    // Among the passes whose dependencies are scheduled, the one that has
+    // waited the longest goes first. Independent work then ends up between
+    // a pass and the ones that depend on it, so their barriers wait less.
+    std::vector<size_t> schedule {};
+    std::vector<size_t> ready {};
+    std::vector<size_t> ready_since (_passes.size(), 0);
+    for (size_t i = 0; i < _passes.size(); i++) {
+        if (alive[i] && dependency_counts[i] == 0) ready.push_back(i);
+    }
+    while (!ready.empty()) {
+        auto next = std::min_element(ready.begin(), ready.end(), [&ready_since](size_t a, size_t b) {
+            return std::make_pair(ready_since[a], a) < std::make_pair(ready_since[b], b);
+        });
+        size_t pass = *next;
+        ready.erase(next);
+        schedule.push_back(pass);
+        for (size_t dependent : dependents[pass]) {
+            if (--dependency_counts[dependent] == 0) {
+                ready_since[dependent] = schedule.size();
+                ready.push_back(dependent);
+            }
+        }
+    }
+    return schedule;
+}
+
+void vktest::RenderGraph::allocate_images () {
+    struct Block {
+        VkDeviceSize size;
+        uint32_t memory_type_bits;
+        VkMemoryPropertyFlags properties;
+        std::vector<RenderGraphImage> images;
+    };
+    const PhysicalDevice &physical_device = _device->get_physical_device();
+    const VkMemoryPropertyFlags lazy_properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+                                                | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+    std::vector<Block> blocks {};
+    std::vector<RenderGraphImage> transients {};
+    std::vector<VkMemoryRequirements> requirements (_resources.size());
+    std::vector<VkMemoryPropertyFlags> properties (_resources.size(), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    for (RenderGraphImage i = 0; i < _resources.size(); i++) {
+        Resource &resource = _resources[i];
+        if (!resource.info) continue;
+        resource.owned = std::make_unique<Image>(*_device, *resource.info);
+        resource.image = resource.owned.get();
+        requirements[i] = resource.image->get_memory_requirements();
+        // Attachments that never leave the tile memory, like a multisampled
+        // color or a depth that is not stored, need no memory behind them on
+        // tiled GPUs. Where lazily allocated memory exists, the implementation
+        // only commits what it ends up using.
+        if ( (resource.info->usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT)
+          && find_memory_type(physical_device, requirements[i].memoryTypeBits, lazy_properties) ) {
+            properties[i] = lazy_properties;
+        }
+        if (resource.transient) {
+            transients.push_back(i);
+        } else {
+            blocks.push_back(Block { requirements[i].size, requirements[i].memoryTypeBits, properties[i], { i } });
+        }
+    }
+    size_t persistent_block_count = blocks.size();
+
+    // Two images can share memory if they are never used by the same pass or
+    // by passes in between. The largest images are placed first, so that the
+    // smaller ones fill the blocks they leave.
+    auto overlaps = [this](RenderGraphImage a, RenderGraphImage b) {
+        const Resource &x = _resources[a];
+        const Resource &y = _resources[b];
+        if (!x.first_pass || !y.first_pass) return false;
+        return *x.first_pass <= y.last_pass && *y.first_pass <= x.last_pass;
+    };
+    for (RenderGraphImage i : transients) _stats.transient_size += requirements[i].size;
+    std::stable_sort(transients.begin(), transients.end(), [&requirements](RenderGraphImage a, RenderGraphImage b) {
+        return requirements[a].size > requirements[b].size;
+    });
+    for (RenderGraphImage i : transients) {
+        const VkMemoryRequirements &mem_reqs = requirements[i];
+        auto block = std::find_if(blocks.begin() + persistent_block_count, blocks.end(), [&](const Block &block) {
+            if (block.properties != properties[i]) return false;
+            if ( !find_memory_type(physical_device, block.memory_type_bits & mem_reqs.memoryTypeBits, block.properties) ) {
+                return false;
+            }
+            return std::none_of(block.images.begin(), block.images.end(),
+                                [&](RenderGraphImage other) { return overlaps(i, other); });
+        });
+        if (block == blocks.end()) {
+            blocks.push_back(Block { mem_reqs.size, mem_reqs.memoryTypeBits, properties[i], { i } });
+            continue;
+        }
+        // Every image is bound at the start of the block, which satisfies
+        // any alignment.
+        block->size = std::max(block->size, mem_reqs.size);
+        block->memory_type_bits &= mem_reqs.memoryTypeBits;
+        block->images.push_back(i);
+    }
+
+    for (size_t b = 0; b < blocks.size(); b++) {
+        Block &block = blocks[b];
+        std::optional<uint32_t> memory_type_index = find_memory_type(physical_device,
+                                                                     block.memory_type_bits,
+                                                                     block.properties);
+        if (!memory_type_index) throw std::runtime_error("Failed to find suitable memory");
+        _memories.push_back( std::make_unique<DeviceMemory>(*_device, block.size, *memory_type_index) );
+        for (RenderGraphImage i : block.images) _resources[i].image->bind_memory(*_memories.back(), 0);
+        if (block.properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) {
+            _lazy_memories.push_back(_memories.back().get());
+            _stats.lazy_size += block.size;
+        }
+        if (b < persistent_block_count) continue;
+        _stats.transient_allocated_size += block.size;
+
+        // In the order of the frame, each image waits for the one before.
+        // The first one waits for the last one of the previous frame.
+        std::vector<RenderGraphImage> users {};
+        std::copy_if(block.images.begin(), block.images.end(), std::back_inserter(users),
+                     [this](RenderGraphImage i) { return _resources[i].first_pass.has_value(); });
+        std::sort(users.begin(), users.end(), [this](RenderGraphImage a, RenderGraphImage b) {
+            return *_resources[a].first_pass < *_resources[b].first_pass;
+        });
+        if (users.size() < 2) continue;
+        for (size_t k = 0; k < users.size(); k++) {
+            _resources[users[k]].aliased = users[(k + users.size() - 1) % users.size()];
+        }
+    }
+}
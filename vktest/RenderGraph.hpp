@@ -0,0 +1,163 @@
+#ifndef __VKTEST_RENDERGRAPH_HPP__
+#define __VKTEST_RENDERGRAPH_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Device.hpp"
+#include "DeviceMemory.hpp"
+#include "Image.hpp"
+#include "ImageState.hpp"
+#include "CommandBuffer.hpp"
+
+namespace vktest {
+    /**
+     * A handle to an image of a RenderGraph.
+     */
+    using RenderGraphImage = uint32_t;
+
+    /**
+     * A pass of a RenderGraph: the images it accesses and a function that
+     * records its commands. Each image is declared at most once per pass.
+     */
+    class RenderGraphPass {
+    public:
+        using Record = std::function<void (const CommandBuffer &cmdbuf, uint32_t image_index)>;
+
+        RenderGraphPass (std::string name, Record record);
+        const std::string &get_name () const noexcept;
+        RenderGraphPass &read (RenderGraphImage image,
+                               VkImageLayout layout,
+                               VkPipelineStageFlags stages,
+                               VkAccessFlags access);
+        /**
+         * @param discard The pass overwrites the whole image, so its previous
+         * contents are not needed.
+         */
+        RenderGraphPass &write (RenderGraphImage image,
+                                VkImageLayout layout,
+                                VkPipelineStageFlags stages,
+                                VkAccessFlags access,
+                                bool discard = false);
+        /**
+         * The pass has effects the graph does not see, such as writing buffers
+         * or a swap chain image. It is never culled and keeps its order among
+         * the other such passes.
+         */
+        RenderGraphPass &set_side_effects () noexcept;
+        /**
+         * The pass is executed after the pass named *name*, which has to be
+         * added before it, for accesses the graph does not see, such as a
+         * buffer that one writes and the other reads. The other pass is kept
+         * as long as this one is.
+         */
+        RenderGraphPass &depend_on (std::string name);
+
+    private:
+        struct Access {
+            RenderGraphImage image;
+            ImageAccess access;
+            bool write;
+            bool discard;
+        };
+
+        std::string _name;
+        Record _record;
+        std::vector<Access> _accesses;
+        std::vector<std::string> _dependencies;
+        bool _side_effects;
+
+        friend class RenderGraph;
+    };
+
+    struct RenderGraphStats {
+        size_t pass_count = 0;
+        size_t culled_pass_count = 0;
+        // What the transient images would take in separate allocations.
+        VkDeviceSize transient_size = 0;
+        // What they take once aliased.
+        VkDeviceSize transient_allocated_size = 0;
+        // What is allocated from lazily allocated memory, persistent or not.
+        VkDeviceSize lazy_size = 0;
+    };
+
+    /**
+     * Describes a frame as passes that read and write images. Compiling the
+     * graph culls the passes whose results are never used, orders the rest,
+     * and places the transient images whose lifetimes do not overlap in the
+     * same memory. Transient attachments are placed in lazily allocated
+     * memory where the device has it. Executing it records the barriers before every pass,
+     * derived from the declared accesses.
+     */
+    class RenderGraph {
+    public:
+        RenderGraph (const Device &device);
+        RenderGraph (const RenderGraph &) = delete;
+        RenderGraph (RenderGraph &&other) noexcept;
+        /**
+         * An image owned elsewhere. Its contents are kept across frames.
+         */
+        RenderGraphImage import_image (const Image &image);
+        /**
+         * An image created by the graph when it is compiled.
+         *
+         * @param transient The contents are only needed within a frame, so
+         * the memory may be shared with other transient images.
+         */
+        RenderGraphImage create_image (const VkImageCreateInfo &info, bool transient = true);
+        /**
+         * The pass is executed after the passes added before it that access
+         * the same images. The reference is valid until the next pass is
+         * added.
+         */
+        RenderGraphPass &add_pass (std::string name, RenderGraphPass::Record record);
+        void compile ();
+        /**
+         * Only valid after *compile* for the images created by the graph.
+         */
+        const Image &get_image (RenderGraphImage image) const noexcept;
+        const RenderGraphStats &get_stats () const noexcept;
+        /**
+         * The bytes the implementation has committed so far for the lazily
+         * allocated memory. It may grow as frames are rendered.
+         */
+        VkDeviceSize get_committed_lazy_size () const noexcept;
+        void execute (const CommandBuffer &cmdbuf, uint32_t image_index) const;
+
+    private:
+        struct Resource {
+            const Image *image = nullptr;
+            std::unique_ptr<Image> owned {};
+            std::optional<VkImageCreateInfo> info {};
+            bool transient = false;
+            // The scheduled passes that access the image first and last.
+            std::optional<size_t> first_pass {};
+            size_t last_pass = 0;
+            ImageAccess last_access {};
+            // The transient image that used the memory before this one. Its
+            // accesses have to finish before this one starts.
+            std::optional<RenderGraphImage> aliased {};
+        };
+
+        std::vector<std::vector<size_t>> find_dependencies () const;
+        std::vector<bool> cull_passes (const std::vector<std::vector<size_t>> &dependencies) const;
+        std::vector<size_t> schedule_passes (const std::vector<bool> &alive,
+                                             const std::vector<std::vector<size_t>> &dependencies) const;
+        void allocate_images ();
+
+        const Device *_device;
+        // Declared first so that the images are destroyed before it.
+        std::vector<std::unique_ptr<DeviceMemory>> _memories;
+        std::vector<const DeviceMemory *> _lazy_memories;
+        std::vector<Resource> _resources;
+        std::vector<RenderGraphPass> _passes;
+        std::vector<size_t> _schedule;
+        RenderGraphStats _stats;
+    };
+}
+
+#endif /* __VKTEST_RENDERGRAPH_HPP__ */
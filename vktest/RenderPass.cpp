@@ -5,13 +5,21 @@ vktest::RenderPass::RenderPass (const Device &device,
                                 VkFormat format,
                                 VkFormat depth_format,
                                 VkSampleCountFlagBits msaa_samples,
-                                const std::vector<VkSubpassDependency> &dependencies) : _device {&device} {
-    std::vector<VkAttachmentDescription> attachments = prepare_attachments(format, depth_format, msaa_samples);
+                                const std::vector<VkSubpassDependency> &dependencies,
+                                bool depth_prepass,
+                                bool store_depth) : _device {&device} {
+    std::vector<VkAttachmentDescription> attachments = prepare_attachments(format, depth_format, msaa_samples,
+                                                                           store_depth);
     std::vector<VkAttachmentReference> color_attachment_refs = prepare_color_attachment_refs();
     VkAttachmentReference depth_attachment_ref = prepare_depth_attachment_ref();
-    std::vector<VkAttachmentReference> resolve_attachment_refs = prepare_resolve_attachment_refs();
+    // Without multisampling the scene image is the color attachment itself
+    // and nothing has to be resolved.
+    std::vector<VkAttachmentReference> resolve_attachment_refs {};
+    if (msaa_samples != VK_SAMPLE_COUNT_1_BIT) resolve_attachment_refs = prepare_resolve_attachment_refs();
+    VkAttachmentReference read_only_depth_attachment_ref = prepare_depth_attachment_ref(VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL);
     std::vector<VkSubpassDescription> subpasses = prepare_subpasses(
-            color_attachment_refs, &depth_attachment_ref, resolve_attachment_refs);
+            color_attachment_refs, &depth_attachment_ref, resolve_attachment_refs,
+            depth_prepass ? &read_only_depth_attachment_ref : nullptr);
 
     VkRenderPassCreateInfo create_info {};
     create_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -46,7 +54,8 @@ const vktest::Device &vktest::RenderPass::get_device () const noexcept {
 }
 
 std::vector<VkAttachmentDescription> vktest::RenderPass::prepare_attachments (
-        VkFormat format, VkFormat depth_format, VkSampleCountFlagBits msaa_samples) const noexcept {
+        VkFormat format, VkFormat depth_format, VkSampleCountFlagBits msaa_samples,
+        bool store_depth) const noexcept {
     VkAttachmentDescription color_attachment {};
     color_attachment.format = format;
     color_attachment.samples = msaa_samples;
@@ -56,7 +65,9 @@ std::vector<VkAttachmentDescription> vktest::RenderPass::prepare_attachments (
     //  * loadOp and storeOp: color and depth data
     //  * stencilLoadOp and stencilStoreOp: stencil data
     color_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // Only the resolved samples are needed afterwards. On tiled GPUs the
+    // multisampled image then never has to be written to memory.
+    color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
 
@@ -76,9 +87,9 @@ std::vector<VkAttachmentDescription> vktest::RenderPass::prepare_attachments (
     depth_attachment.format = depth_format;
     depth_attachment.samples = msaa_samples;
     depth_attachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    // This time we don't care about storing the depth data (storeOp), because
-    // it will not be used after drawing has finished.
-    depth_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    // We don't care about storing the depth data (storeOp), unless it is used
+    // after drawing has finished, as the depth pyramid of the next frame is.
+    depth_attachment.storeOp = store_depth ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     depth_attachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -93,8 +104,16 @@ std::vector<VkAttachmentDescription> vktest::RenderPass::prepare_attachments (
     color_attachment_resolve.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     color_attachment_resolve.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     color_attachment_resolve.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
-
+    // The single-sampled image is not presented directly but blitted (and
+    // scaled) into the swap chain image after the render pass.
+    color_attachment_resolve.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+    if (msaa_samples == VK_SAMPLE_COUNT_1_BIT) {
+        // Without multisampling it is the scene image itself.
+        color_attachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+        color_attachment.finalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        return std::vector { color_attachment, depth_attachment };
+    }
     return std::vector { color_attachment, depth_attachment, color_attachment_resolve };
 }
 
@@ -117,27 +136,37 @@ std::vector<VkAttachmentReference> vktest::RenderPass::prepare_resolve_attachmen
     return std::vector { color_attachment_resolve_ref };
 }
 
-VkAttachmentReference vktest::RenderPass::prepare_depth_attachment_ref () const noexcept {
+VkAttachmentReference vktest::RenderPass::prepare_depth_attachment_ref (VkImageLayout layout) const noexcept {
     VkAttachmentReference depth_attachment_ref{};
     depth_attachment_ref.attachment = 1;
-    depth_attachment_ref.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depth_attachment_ref.layout = layout;
     return depth_attachment_ref;
 }
 
 std::vector<VkSubpassDescription> vktest::RenderPass::prepare_subpasses (
             const std::vector<VkAttachmentReference> &color_attachment_refs,
             const VkAttachmentReference *depth_attachment_ref,
-            const std::vector<VkAttachmentReference> &resolve_attachment_refs) const noexcept {
+            const std::vector<VkAttachmentReference> &resolve_attachment_refs,
+            const VkAttachmentReference *read_only_depth_attachment_ref) const noexcept {
     VkSubpassDescription subpass {};
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = static_cast<uint32_t>( color_attachment_refs.size() );
     subpass.pColorAttachments = color_attachment_refs.data();
     subpass.pDepthStencilAttachment = depth_attachment_ref;
-    subpass.pResolveAttachments = resolve_attachment_refs.data();
+    subpass.pResolveAttachments = resolve_attachment_refs.empty() ? nullptr : resolve_attachment_refs.data();
     // The following other types of attachments can be referenced by a subpass:
     //  * pInputAttachments: Attachments that are read from a shader
     //  * pResolveAttachments: Attachments used for multisampling color attachments
     //  * pDepthStencilAttachment: Attachment for depth and stencil data
     //  * pPreserveAttachments: Attachments that are not used by this subpass, but for which the data must be preserved
-    return std::vector { subpass };
+    if (read_only_depth_attachment_ref == nullptr) return std::vector { subpass };
+
+    // Depth pre-pass: the first subpass only writes depth, so the color
+    // subpass shades just the visible fragments and never writes depth.
+    VkSubpassDescription depth_subpass {};
+    depth_subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    depth_subpass.colorAttachmentCount = 0;
+    depth_subpass.pDepthStencilAttachment = depth_attachment_ref;
+    subpass.pDepthStencilAttachment = read_only_depth_attachment_ref;
+    return std::vector { depth_subpass, subpass };
 }
@@ -9,9 +9,17 @@
 namespace vktest {
     class RenderPass {
     public:
+        /**
+         * @param depth_prepass Adds a depth-only subpass before the color
+         * subpass, which then only reads the depth attachment.
+         * @param store_depth The depth attachment is read after the render
+         * pass, otherwise its contents are discarded.
+         */
         RenderPass (const Device &device,
                 VkFormat format, VkFormat depth_format, VkSampleCountFlagBits msaa_samples,
-                const std::vector<VkSubpassDependency> &dependencies);
+                const std::vector<VkSubpassDependency> &dependencies,
+                bool depth_prepass = false,
+                bool store_depth = true);
         RenderPass (const RenderPass &) = delete;
         RenderPass (RenderPass &&other) noexcept;
         ~RenderPass ();
@@ -20,14 +28,17 @@ namespace vktest {
 
     private:
         std::vector<VkAttachmentDescription> prepare_attachments (
-                VkFormat format, VkFormat depth_format, VkSampleCountFlagBits msaa_samples) const noexcept;
+                VkFormat format, VkFormat depth_format, VkSampleCountFlagBits msaa_samples,
+                bool store_depth) const noexcept;
         std::vector<VkAttachmentReference> prepare_color_attachment_refs () const noexcept;
-        VkAttachmentReference prepare_depth_attachment_ref () const noexcept;
+        VkAttachmentReference prepare_depth_attachment_ref (
+                VkImageLayout layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL) const noexcept;
         std::vector<VkAttachmentReference> prepare_resolve_attachment_refs () const noexcept;
         std::vector<VkSubpassDescription> prepare_subpasses (
                 const std::vector<VkAttachmentReference> &color_attachment_refs,
                 const VkAttachmentReference *depth_attachment_ref,
-                const std::vector<VkAttachmentReference> &resolve_attachment_refs) const noexcept;
+                const std::vector<VkAttachmentReference> &resolve_attachment_refs,
+                const VkAttachmentReference *read_only_depth_attachment_ref) const noexcept;
 
         VkRenderPass _native;
         const Device *_device;
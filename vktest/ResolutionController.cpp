@@ -0,0 +1,57 @@
+#include "ResolutionController.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace vktest {
+    // Weight of the newest frame in the moving average.
+    static const double SMOOTHING = 0.1;
+    // Frames to measure after a change before the scale may change again.
+    static const uint32_t SETTLE_FRAMES = 30;
+    // The scale is kept while the average is within this fraction of the
+    // target.
+    static const double HYSTERESIS = 0.1;
+    // Limits of a single change, so a hitch does not drop the resolution all
+    // the way at once.
+    static const float MIN_STEP = 0.8f;
+    static const float MAX_STEP = 1.1f;
+}
+
+vktest::ResolutionController::ResolutionController (double target_frame_time, float min_scale, float max_scale) noexcept
+        : _target_frame_time {target_frame_time},
+          _min_scale {min_scale},
+          _max_scale {max_scale},
+          _scale {max_scale},
+          _average_frame_time {0.0},
+          _frames_at_scale {0} {
+}
+
+float vktest::ResolutionController::update (double frame_time) noexcept {
+    if (frame_time <= 0.0) return _scale;
+    if (_average_frame_time == 0.0) {
+        _average_frame_time = frame_time;
+    } else {
+        _average_frame_time += (frame_time - _average_frame_time) * SMOOTHING;
+    }
+    if (++_frames_at_scale < SETTLE_FRAMES) return _scale;
+
+    double ratio = _target_frame_time / _average_frame_time;
+    if (std::abs(ratio - 1.0) <= HYSTERESIS) return _scale;
+    // The cost of a frame grows with the number of pixels, that is with the
+    // square of the scale.
+    float step = std::clamp(static_cast<float>(std::sqrt(ratio)), MIN_STEP, MAX_STEP);
+    float scale = std::clamp(_scale * step, _min_scale, _max_scale);
+    if (scale == _scale) return _scale;
+
+    _scale = scale;
+    _average_frame_time = 0.0;
+    _frames_at_scale = 0;
+    return _scale;
+}
+
+float vktest::ResolutionController::get_scale () const noexcept {
+    return _scale;
+}
+
+double vktest::ResolutionController::get_average_frame_time () const noexcept {
+    return _average_frame_time;
+}
@@ -0,0 +1,43 @@
+#ifndef __VKTEST_RESOLUTIONCONTROLLER_HPP__
+#define __VKTEST_RESOLUTIONCONTROLLER_HPP__
+
+#include <cstdint>
+
+namespace vktest {
+    /**
+     * Chooses the scale of the internal render resolution, per axis, from the
+     * measured frame times so that they approach a target.
+     *
+     * The frame times are smoothed, and the scale only changes when the
+     * average leaves a band around the target, and not again until the new
+     * scale has been measured for a while, so it does not oscillate.
+     */
+    class ResolutionController {
+    public:
+        /**
+         * @param target_frame_time In milliseconds.
+         */
+        ResolutionController (double target_frame_time, float min_scale, float max_scale) noexcept;
+        /**
+         * Feeds the time of one frame rendered at the current scale, in
+         * milliseconds.
+         *
+         * @return The scale to render the next frame at.
+         */
+        float update (double frame_time) noexcept;
+        float get_scale () const noexcept;
+        double get_average_frame_time () const noexcept;
+
+    private:
+        double _target_frame_time;
+        float _min_scale;
+        float _max_scale;
+        float _scale;
+        // Exponential moving average, 0 until the first frame at the current
+        // scale.
+        double _average_frame_time;
+        uint32_t _frames_at_scale;
+    };
+}
+
+#endif /* __VKTEST_RESOLUTIONCONTROLLER_HPP__ */
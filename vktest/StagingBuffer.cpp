@@ -0,0 +1,61 @@
+#include "StagingBuffer.hpp"
+#include <stdexcept>
+
+namespace vktest {
+    static uint32_t find_staging_memory_type (const PhysicalDevice &physical_device, uint32_t type_filter, bool read_back) {
+        VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        VkPhysicalDeviceMemoryProperties memprops = physical_device.get_memory_properties();
+        // Reading uncached memory goes to the bus for every access, so
+        // cached memory is tried first for buffers that are read back.
+        for (int cached = read_back ? 1 : 0; cached >= 0; cached--) {
+            VkMemoryPropertyFlags wanted = properties | (cached ? VK_MEMORY_PROPERTY_HOST_CACHED_BIT : 0);
+            for (uint32_t i = 0; i < memprops.memoryTypeCount; i++) {
+                if (type_filter & (1 << i)
+                 && (memprops.memoryTypes[i].propertyFlags & wanted) == wanted) {
+                    return i;
+                }
+            }
+        }
+        throw std::runtime_error("Failed to find suitable memory for a staging buffer");
+    }
+}
+
+vktest::StagingBuffer::StagingBuffer (const Device &device, VkDeviceSize size, bool read_back)
+        : _memory {},
+          _buffer {},
+          _size {size},
+          _data {nullptr} {
+    _buffer = std::make_unique<Buffer>(device, size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_SHARING_MODE_EXCLUSIVE);
+    VkMemoryRequirements mem_reqs = _buffer->get_memory_requirements();
+    uint32_t memory_type_index = find_staging_memory_type(device.get_physical_device(), mem_reqs.memoryTypeBits, read_back);
+    _memory = std::make_unique<DeviceMemory>(device, mem_reqs.size, memory_type_index);
+    _buffer->bind_memory(*_memory, 0);
+    _data = static_cast<unsigned char*>(_memory->map(0, VK_WHOLE_SIZE));
+    if (_data == nullptr) throw std::runtime_error("Failed to map a staging buffer");
+}
+
+vktest::StagingBuffer::StagingBuffer (StagingBuffer &&other) noexcept
+        : _memory (std::move(other._memory)),
+          _buffer (std::move(other._buffer)),
+          _size {other._size},
+          _data {other._data} {
+    other._data = nullptr;
+}
+
+vktest::StagingBuffer::~StagingBuffer () {
+    // Freeing the memory unmaps it as well, but the mapping is released
+    // explicitly for symmetry with *map*.
+    if (_data != nullptr) _memory->unmap();
+}
+
+const vktest::Buffer &vktest::StagingBuffer::get_buffer () const noexcept {
+    return *_buffer;
+}
+
+VkDeviceSize vktest::StagingBuffer::get_size () const noexcept {
+    return _size;
+}
+
+unsigned char *vktest::StagingBuffer::get_data () const noexcept {
+    return _data;
+}
@@ -0,0 +1,46 @@
+#ifndef __VKTEST_STAGINGBUFFER_HPP__
+#define __VKTEST_STAGINGBUFFER_HPP__
+
+#define GLFW_INCLUDE_VULKAN
+#include <GLFW/glfw3.h>
+#include <memory>
+#include "Device.hpp"
+#include "Buffer.hpp"
+#include "DeviceMemory.hpp"
+
+namespace vktest {
+    /**
+     * A transfer source buffer in host visible, coherent memory that stays
+     * mapped for its whole lifetime, so assets can be decoded straight into
+     * it instead of into a host allocation that is copied afterwards. It may
+     * be created and written on any thread.
+     */
+    class StagingBuffer {
+    public:
+        /**
+         * @param read_back The contents are read on the host as well, so
+         * host cached memory is chosen where the device has it.
+         */
+        StagingBuffer (const Device &device, VkDeviceSize size, bool read_back = false);
+        StagingBuffer (const StagingBuffer &) = delete;
+        StagingBuffer (StagingBuffer &&other) noexcept;
+        ~StagingBuffer ();
+        const Buffer &get_buffer () const noexcept;
+        VkDeviceSize get_size () const noexcept;
+        /**
+         * The mapped memory. Unless it was created to be read back, it is
+         * write-combined on many devices, so it should be written
+         * sequentially and not read.
+         */
+        unsigned char *get_data () const noexcept;
+
+    private:
+        // Declared first so that the buffer is destroyed before it.
+        std::unique_ptr<DeviceMemory> _memory;
+        std::unique_ptr<Buffer> _buffer;
+        VkDeviceSize _size;
+        unsigned char *_data;
+    };
+}
+
+#endif /* __VKTEST_STAGINGBUFFER_HPP__ */
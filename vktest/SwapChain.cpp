@@ -55,10 +55,11 @@ namespace vktest {
 
 vktest::SwapChain::SwapChain (const Device &device,
                               const Surface &surface,
-                              const SwapChainSupport &support)
+                              const SwapChainSupport &support,
+                              const SwapChain *old_swap_chain)
         : _device {&device}, _surface {&surface},
-          _images {}, _image_views {},
-          _framebuffers {}, _command_buffers {} {
+          _images {},
+          _command_buffers {} {
     VkSurfaceFormatKHR format = choose_format(support);
     _image_format = format.format;
     VkPresentModeKHR present_mode = choose_present_mode(support);
@@ -92,7 +93,13 @@ vktest::SwapChain::SwapChain (const Device &device,
     // to perform operations like post-processing. In that case you may use a
     // value like VK_IMAGE_USAGE_TRANSFER_DST_BIT instead and use a memory
     // operation to transfer the rendered image to a swap chain image.
-    create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    //
+    // The scene is rendered at a variable resolution into a separate image,
+    // which is blitted into the swap chain image.
+    if ( !(support.capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) ) {
+        throw std::runtime_error("Swap chain images cannot be transfer destinations");
+    }
+    create_info.imageUsage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
     const QueueFamilyIndices &queue_families = device.get_physical_device().get_queue_families();
     uint32_t indices[] = { queue_families.graphics.value(), queue_families.present.value() };
@@ -122,22 +129,20 @@ vktest::SwapChain::SwapChain (const Device &device,
     // care about the color of pixels that are obscured, for example because
     // another window is in front of them.
     create_info.clipped = VK_TRUE;
-    // TODO: Swap chain recreation
-    create_info.oldSwapchain = VK_NULL_HANDLE;
+    // The swap chain that is replaced is retired. Its images that have been
+    // acquired can still be presented, and it is destroyed later.
+    create_info.oldSwapchain = old_swap_chain ? old_swap_chain->get_native() : VK_NULL_HANDLE;
 
     VkResult res = vkCreateSwapchainKHR(device.get_native(), &create_info, nullptr, &_native);
     if (res != VK_SUCCESS) throw std::runtime_error("Failed to create swap chain");
 
     fetch_images();
-    create_image_views();
 }
 
 vktest::SwapChain::SwapChain (SwapChain &&other) noexcept
         : _image_format {other._image_format},
           _extent {std::move(other._extent)},
           _images (std::move(other._images)),
-          _image_views (std::move(other._image_views)),
-          _framebuffers (std::move(other._framebuffers)),
           _command_buffers (std::move(other._command_buffers)) {
     _native = other._native;
     _device = other._device;
@@ -169,19 +174,6 @@ const VkExtent2D &vktest::SwapChain::get_extent () const noexcept {
     return _extent;
 }
 
-void vktest::SwapChain::create_framebuffers (const RenderPass &render_pass,
-                                             const ImageView *color_image_view,
-                                             const ImageView *depth_image_view) {
-    _framebuffers.reserve( _images.size() );
-    for (size_t i = 0; i < _images.size(); i++) {
-        std::vector<const ImageView*> attachments {};
-        if (color_image_view != nullptr) attachments.push_back(color_image_view);
-        if (depth_image_view != nullptr) attachments.push_back(depth_image_view);
-        attachments.push_back(&_image_views[i]);
-        _framebuffers.emplace_back(*_device, render_pass, _extent, attachments);
-    }
-}
-
 void vktest::SwapChain::create_command_buffers (const CommandPool &command_pool) {
     _command_buffers = command_pool.allocate_buffers(static_cast<uint32_t>(_images.size()), VK_COMMAND_BUFFER_LEVEL_PRIMARY);
 }
@@ -190,14 +182,6 @@ const std::vector<VkImage> &vktest::SwapChain::get_images () const noexcept {
     return _images;
 }
 
-const std::vector<vktest::ImageView> &vktest::SwapChain::get_image_views () const noexcept {
-    return _image_views;
-}
-
-const std::vector<vktest::Framebuffer> &vktest::SwapChain::get_framebuffers () const noexcept {
-    return _framebuffers;
-}
-
 std::vector<vktest::CommandBuffer*> vktest::SwapChain::get_command_buffers () noexcept {
     std::vector<CommandBuffer*> result = vktest::pvec<CommandBuffer>(_command_buffers);
     return result;
@@ -231,11 +215,3 @@ void vktest::SwapChain::fetch_images () noexcept {
     _images.resize(count);
     vkGetSwapchainImagesKHR(_device->get_native(), _native, &count, _images.data());
 }
-
-void vktest::SwapChain::create_image_views () noexcept {
-    _image_views.reserve( _images.size() );
-    for (size_t i = 0; i < _images.size(); i++) {
-        _image_views.emplace_back(*_device,
-                _images[i], _image_format, VK_IMAGE_ASPECT_COLOR_BIT, 1);
-    }
-}
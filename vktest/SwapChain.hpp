@@ -9,9 +9,6 @@
 #include "SwapChainSupport.hpp"
 #include "Surface.hpp"
 #include "Device.hpp"
-#include "ImageView.hpp"
-#include "Framebuffer.hpp"
-#include "RenderPass.hpp"
 #include "CommandPool.hpp"
 #include "CommandBuffer.hpp"
 #include "Semaphore.hpp"
@@ -20,9 +17,14 @@
 namespace vktest {
     class SwapChain {
     public:
+        /**
+         * @param old_swap_chain The swap chain of the surface that is being
+         * replaced, if any.
+         */
         SwapChain (const Device &device,
                    const Surface &surface,
-                   const SwapChainSupport &support);
+                   const SwapChainSupport &support,
+                   const SwapChain *old_swap_chain = nullptr);
         SwapChain (const SwapChain &) = delete;
         SwapChain (SwapChain &&other) noexcept;
         ~SwapChain ();
@@ -31,13 +33,8 @@ namespace vktest {
         const Surface &get_surface () const noexcept;
         VkFormat get_image_format () const noexcept;
         const VkExtent2D &get_extent () const noexcept;
-        void create_framebuffers (const RenderPass &render_pass,
-                                  const ImageView *color_image_view,
-                                  const ImageView *depth_image_view);
         void create_command_buffers (const CommandPool &command_pool);
         const std::vector<VkImage> &get_images () const noexcept;
-        const std::vector<ImageView> &get_image_views () const noexcept;
-        const std::vector<Framebuffer> &get_framebuffers () const noexcept;
         std::vector<CommandBuffer*> get_command_buffers () noexcept;
         CommandBuffer &get_command_buffer (uint32_t index) noexcept;
 
@@ -51,7 +48,6 @@ namespace vktest {
 
     private:
         void fetch_images () noexcept;
-        void create_image_views () noexcept;
 
         VkSwapchainKHR _native;
         const Device *_device;
@@ -59,8 +55,6 @@ namespace vktest {
         VkFormat _image_format;
         VkExtent2D _extent;
         std::vector<VkImage> _images;
-        std::vector<ImageView> _image_views;
-        std::vector<Framebuffer> _framebuffers;
         std::vector<CommandBuffer> _command_buffers;
     };
 }
@@ -14,6 +14,14 @@
 #include <vector>
 
 namespace vktest {
+    /**
+     * Per-vertex data other than the position, stored in its own stream.
+     */
+    struct VertexAttributes {
+        glm::vec3 color;
+        glm::vec2 tex_coord;
+    };
+
     struct Vertex {
         glm::vec3 pos;
         glm::vec3 color;
@@ -23,12 +31,47 @@ namespace vktest {
             return pos == other.pos && color == other.color && tex_coord == other.tex_coord;
         }
 
+        VertexAttributes get_attributes () const noexcept {
+            return { color, tex_coord };
+        }
+
+        /**
+         * Vertex data is split into two streams: positions in binding 0 and
+         * the remaining attributes (see VertexAttributes) in binding 1. Passes
+         * that only need positions, like depth-only or shadow passes, can bind
+         * the first stream alone and fetch less data per vertex.
+         */
         static std::vector<VkVertexInputBindingDescription> get_binding_descs () {
+            std::vector<VkVertexInputBindingDescription> binding_descs = get_position_binding_descs();
+            binding_descs.resize(2);
+            binding_descs[1].binding = 1;
+            binding_descs[1].stride = sizeof(VertexAttributes);
+            binding_descs[1].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+            return binding_descs;
+        }
+
+        static std::vector<VkVertexInputAttributeDescription> get_attribute_descs () {
+            std::vector<VkVertexInputAttributeDescription> attribute_descs = get_position_attribute_descs();
+            attribute_descs.resize(3);
+
+            attribute_descs[1].binding = 1;
+            attribute_descs[1].location = 1;
+            attribute_descs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
+            attribute_descs[1].offset = offsetof(VertexAttributes, color);
+
+            attribute_descs[2].binding = 1;
+            attribute_descs[2].location = 2;
+            attribute_descs[2].format = VK_FORMAT_R32G32_SFLOAT;
+            attribute_descs[2].offset = offsetof(VertexAttributes, tex_coord);
+            return attribute_descs;
+        }
+
+        static std::vector<VkVertexInputBindingDescription> get_position_binding_descs () {
             std::vector<VkVertexInputBindingDescription> binding_descs (1);
             // Specifies the index of the binding in the array of bindings.
             binding_descs[0].binding = 0;
             // Specifies the number of bytes from one entry to the next.
-            binding_descs[0].stride = sizeof(Vertex);
+            binding_descs[0].stride = sizeof(glm::vec3);
             // The inputRate parameter:
             //  * VK_VERTEX_INPUT_RATE_VERTEX: Move to the next data entry after each vertex.
             //  * VK_VERTEX_INPUT_RATE_INSTANCE: Move to the next data entry after each instance.
@@ -36,11 +79,11 @@ namespace vktest {
             return binding_descs;
         }
 
-        static std::vector<VkVertexInputAttributeDescription> get_attribute_descs () {
+        static std::vector<VkVertexInputAttributeDescription> get_position_attribute_descs () {
             // An attribute description struct describes how to extract a
             // vertex attribute from a chunk of vertex data originating from a
             // binding description.
-            std::vector<VkVertexInputAttributeDescription> attribute_descs (3);
+            std::vector<VkVertexInputAttributeDescription> attribute_descs (1);
 
             // binding: Tells Vulkan from which binding the per-vertex data comes.
             attribute_descs[0].binding = 0;
@@ -60,17 +103,7 @@ namespace vktest {
             // number of channels is lower than the number of components, then
             // the BGA components will use default values of (0, 0, 1).
             attribute_descs[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attribute_descs[0].offset = offsetof(Vertex, pos);
-
-            attribute_descs[1].binding = 0;
-            attribute_descs[1].location = 1;
-            attribute_descs[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-            attribute_descs[1].offset = offsetof(Vertex, color);
-
-            attribute_descs[2].binding = 0;
-            attribute_descs[2].location = 2;
-            attribute_descs[2].format = VK_FORMAT_R32G32_SFLOAT;
-            attribute_descs[2].offset = offsetof(Vertex, tex_coord);
+            attribute_descs[0].offset = 0;
             return attribute_descs;
         }
     };
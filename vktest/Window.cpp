@@ -30,6 +30,14 @@ void vktest::Window::set_framebuffer_resize_callback (GLFWframebuffersizefun cal
     glfwSetFramebufferSizeCallback(_native, callback);
 }
 
+void vktest::Window::set_key_callback (GLFWkeyfun callback) const noexcept {
+    glfwSetKeyCallback(_native, callback);
+}
+
+void vktest::Window::set_title (const std::string &title) const noexcept {
+    glfwSetWindowTitle(_native, title.c_str());
+}
+
 void vktest::Window::get_framebuffer_size (int *width, int *height) const noexcept {
     glfwGetFramebufferSize(_native, width, height);
 }
@@ -16,6 +16,8 @@ namespace vktest {
         void *get_user_pointer () const noexcept;
         void set_user_pointer (void *pointer) const noexcept;
         void set_framebuffer_resize_callback (GLFWframebuffersizefun callback) const noexcept;
+        void set_key_callback (GLFWkeyfun callback) const noexcept;
+        void set_title (const std::string &title) const noexcept;
         void get_framebuffer_size (int *width, int *height) const noexcept;
 
     private:
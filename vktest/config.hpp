@@ -3,18 +3,130 @@
 
 #include <vector>
 #include "Vertex.hpp"
+#include "QualityProfile.hpp"
 
 #define WIDTH 800
 #define HEIGHT 600
 
 #define MODEL_PATH "data/model.obj"
-#define TEXTURE_PATH "data/texture.png"
+#define TEXTURE_PATH "data/texture.ktx2"
 
 /**
  * Defines how many frames should be processed concurrently.
  */
 #define MAX_FRAMES_IN_FLIGHT 2
 
+/**
+ * Number of levels of detail generated for the model at load time. Each level
+ * keeps about LOD_REDUCTION times the triangles of the previous one.
+ */
+#define LOD_COUNT 4
+#define LOD_REDUCTION 0.5f
+
+/**
+ * The coarsest level of detail whose simplification error projects to at
+ * most this many pixels on screen is drawn.
+ */
+#define LOD_PIXEL_ERROR 1.0f
+
+/**
+ * Limits for the meshlets (clusters of triangles) that are culled against the
+ * view frustum and by their normal cone before drawing.
+ */
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+/**
+ * The model is drawn as an INSTANCE_GRID_SIZE x INSTANCE_GRID_SIZE grid of
+ * instances, INSTANCE_SPACING units apart.
+ */
+#define INSTANCE_GRID_SIZE 1
+#define INSTANCE_SPACING 2.5f
+
+/**
+ * Renders the depth of the scene in a depth-only subpass first, so the color
+ * subpass shades each sample once instead of once per overlapping triangle.
+ */
+#define DEPTH_PREPASS true
+
+/**
+ * Renders with dynamic rendering (core in Vulkan 1.3, VK_KHR_dynamic_rendering
+ * before) instead of a render pass and a framebuffer, when supported.
+ */
+#define DYNAMIC_RENDERING true
+
+/**
+ * Binds the textures of all materials at once, as an array indexed by the
+ * material of each instance (descriptor indexing, core in Vulkan 1.2), when
+ * supported. BINDLESS_TEXTURE_COUNT is the size of the array, well below the
+ * limits guaranteed along with the feature.
+ */
+#define BINDLESS true
+#define BINDLESS_TEXTURE_COUNT 1024
+
+/**
+ * Writes the per-frame scene descriptors straight into the command buffer
+ * (VK_KHR_push_descriptor), when supported, instead of allocating and
+ * updating a set every frame.
+ */
+#define PUSH_DESCRIPTORS true
+
+/**
+ * Presents frames right away with a 1x1 texture and an empty model, and swaps
+ * in the real ones between frames once they are loaded in the background.
+ * The time to the first frame then does not depend on the size of the assets.
+ */
+#define PROGRESSIVE_STARTUP true
+
+/**
+ * Textures stored without mip levels get them from one of three generators:
+ * blits from each level to the next, a compute shader that writes all of them
+ * in one dispatch, or a SIMD box filter on the CPU before uploading. Each is
+ * offered where the device supports it for the format. With the speed test,
+ * all of them are timed on the first such texture and the fastest is kept;
+ * otherwise the first one offered, in that order, is used.
+ */
+#define MIP_GENERATION_SPEED_TEST true
+
+/**
+ * The descriptor sets the first pool of a per-frame descriptor allocator
+ * holds. Further pools are added, each twice as large, when a frame needs
+ * more.
+ */
+#define DESCRIPTOR_ALLOCATOR_SET_COUNT 64
+
+/**
+ * The index into *quality_profiles* used at startup. The number keys select
+ * the profiles at runtime, starting with 1.
+ */
+#define DEFAULT_QUALITY_PROFILE 3
+
+/**
+ * Dynamic resolution: the scene is rendered at a fraction of the window size,
+ * adjusted between MIN_RENDER_SCALE and MAX_RENDER_SCALE (per axis) to keep
+ * the GPU time of a frame near TARGET_FRAME_TIME milliseconds, and scaled up
+ * to the window. The attachments are sized for the window, so the scale
+ * cannot exceed 1.
+ */
+#define DYNAMIC_RESOLUTION true
+#define TARGET_FRAME_TIME 16.0
+#define MIN_RENDER_SCALE 0.5f
+#define MAX_RENDER_SCALE 1.0f
+/**
+ * Prints the memory of the attachments whenever they are created: what is
+ * allocated, what is lazily allocated and committed, and what aliasing and
+ * lazy allocation save.
+ */
+#define REPORT_ATTACHMENT_MEMORY false
+/**
+ * Prints the hits, misses and size of the object cache on exit.
+ */
+#define REPORT_OBJECT_CACHE false
+/**
+ * Prints the time of every mip generator the speed test measures.
+ */
+#define REPORT_MIP_GENERATION false
+
 namespace vktest {
     const std::vector<const char*> validation_layers = {
         "VK_LAYER_KHRONOS_validation"
@@ -23,6 +135,13 @@ namespace vktest {
     const std::vector<const char*> device_extensions = {
         VK_KHR_SWAPCHAIN_EXTENSION_NAME
     };
+
+    const std::vector<QualityProfile> quality_profiles = {
+        { "Off", VK_SAMPLE_COUNT_1_BIT, false, 0.0f },
+        { "2x MSAA", VK_SAMPLE_COUNT_2_BIT, false, 4.0f },
+        { "4x MSAA", VK_SAMPLE_COUNT_4_BIT, false, 8.0f },
+        { "Max MSAA", VK_SAMPLE_COUNT_64_BIT, true, 16.0f }
+    };
 }
 
 #endif /* __VKTEST_CONFIG_HPP__ */